@@ -3,573 +3,3559 @@
 #include"buffer_mgr.h"
 #include"storage_mgr.h"
 #include <math.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+
+//arenas at least this large are backed by huge pages when the system allows it
+#define HUGE_PAGE_SIZE (2*1024*1024)
+//background writer checks the dirty frames at least this often
+#define CLEANER_PERIOD_MS 100
+//asynchronous reads of prefetchPages and writes of the background writer in flight
+#define BM_IO_DEPTH 32
+//threads forceFlushPool writes with, and pages it merges into one write at most
+#define BM_FLUSH_THREADS 4
+#define BM_MAX_FLUSH_THREADS 16
+#define BM_FLUSH_RUN 64
+//hits a page table shard of a concurrent pool collects before they update the replacement lists
+#define BM_HIT_BATCH 64
 
-SM_FileHandle *fHandle;
-int wrt,rd;
 typedef struct pageFrame{
     char *data;
     PageNumber pageNo;
     int fixcount;
     bool dirtyBit;
+    bool corrupt;
     int val;
+    bool refBit;
     struct pageFrame *next;
+    struct pageFrame *lruPrev;
+    struct pageFrame *lruNext;
+    long *hist;
+    long last;
+    int heapPos;
+    int freq;
+    struct freqBucket *bucket;
+    struct frameList *owner;
 }pageFrame;
-int bufSize;
+//doubly linked list of frames, first is most recently used
+typedef struct frameList{
+    pageFrame *first;
+    pageFrame *last;
+    int size;
+}frameList;
+//frames with the same reference count, buckets are sorted by freq
+typedef struct freqBucket{
+    int freq;
+    frameList frames;
+    struct freqBucket *prev;
+    struct freqBucket *next;
+}freqBucket;
+//page number of a recently replaced page, kept in a ghost list
+typedef struct ghostEntry{
+    PageNumber pageNo;
+    struct ghostList *owner;
+    struct ghostEntry *prev;
+    struct ghostEntry *next;
+}ghostEntry;
+typedef struct ghostList{
+    ghostEntry *first;
+    ghostEntry *last;
+    int size;
+}ghostList;
+//open addressing hash table mapping page number to frame index
+typedef struct pageTable{
+    PageNumber *pageNo;
+    int *frameIdx;
+    int mask;
+}pageTable;
+//part of the page table with its own latch, padded to a cache line.
+//hitFrames/hitPages are hits not applied to the replacement lists yet
+typedef struct tableShard{
+    pthread_mutex_t latch;
+    pageTable table;
+    long pins;
+    int numHits;
+    int hitFrames[BM_HIT_BATCH];
+    PageNumber hitPages[BM_HIT_BATCH];
+}__attribute__((aligned(64))) tableShard;
 typedef struct Linkedlist{
+    SM_FileHandle *fHandle;
+    int numReadIO;
+    int numWriteIO;
+    bool concurrent;
+    bool checksums;
+    int numShards;
+    tableShard *shards;
+    pthread_mutex_t evictLatch;
+    pthread_mutex_t replLatch;
+    pthread_rwlock_t ioLatch;
+    pthread_cond_t frameFree;
+    int waiters;
+    bool blocking;
+    int numDirty;
+    int cleanerHigh;
+    int cleanerLow;
+    int cleanerPins;
+    bool cleanerStop;
+    pthread_t cleaner;
+    pthread_mutex_t cleanerLatch;
+    pthread_cond_t cleanerWake;
+    int flushThreads;
+    PageNumber *cleanBatch;
+    SM_IOQueue *cleanQueue;
+    SM_IOQueue *ioQueue;
+    bool prefetching;
+    int readsInFlight;
     pageFrame *head;
     pageFrame *tail;
     pageFrame *curPos;
+    pageFrame *clockHand;
     int nodeCount;
+    pageFrame *frames;
+    int *freeFrames;
+    int numFree;
+    int numResident;
+    //the registry changes them under its latch while misses use them, accessed atomically
+    int quota;
+    long windowReads;
+    char *arena;
+    size_t arenaSize;
+    frameList lruList;
+    pageFrame **heap;
+    pageFrame **skipped;
+    int heapSize;
+    long *histArena;
+    int k;
+    int correlatedPeriod;
+    long timeStamp;
+    freqBucket *bucketArena;
+    freqBucket *freeBuckets;
+    freqBucket *minBucket;
+    int agingPeriod;
+    frameList recent;
+    frameList frequent;
+    ghostList ghostRecent;
+    ghostList ghostFrequent;
+    ghostEntry *ghostArena;
+    ghostEntry *freeGhosts;
+    pageTable ghostTable;
+    int arcTarget;
+    int kin;
+    int kout;
 } Linkedlist;
-void FIFO(BM_BufferPool *const bm, BM_PageHandle *const page, const  PageNumber pageNum);
-void LRU(BM_BufferPool *const bm, BM_PageHandle *const page, const  PageNumber pageNum);
+//pools sharing the process wide frame budget
+typedef struct poolRegistry{
+    BM_BufferPool **pools;
+    int numPools;
+    int maxPools;
+    int budget;
+    int assigned;
+}poolRegistry;
+//dirty frames of forceFlushPool sorted by page, split into runs of consecutive
+//pages. Flush threads take the next run until none is left
+typedef struct flushJob{
+    Linkedlist *pg;
+    pageFrame **frames;
+    int *runStart;
+    int numRuns;
+    int nextRun;
+    bool failed;
+}flushJob;
+static poolRegistry registry;
+static pthread_mutex_t registryLatch=PTHREAD_MUTEX_INITIALIZER;
+RC FIFO(BM_BufferPool *const bm, BM_PageHandle *const page, const  PageNumber pageNum);
+RC LRU(BM_BufferPool *const bm, BM_PageHandle *const page, const  PageNumber pageNum);
+RC CLOCK(BM_BufferPool *const bm, BM_PageHandle *const page, const  PageNumber pageNum);
+RC LRU_K(BM_BufferPool *const bm, BM_PageHandle *const page, const  PageNumber pageNum);
+RC LFU(BM_BufferPool *const bm, BM_PageHandle *const page, const  PageNumber pageNum);
+void lfuInsert(Linkedlist *pg, pageFrame *frame, freqBucket *after, int freq);
+void lfuRemove(Linkedlist *pg, pageFrame *frame);
+void lfuAge(Linkedlist *pg);
+RC ARC(BM_BufferPool *const bm, BM_PageHandle *const page, const  PageNumber pageNum);
+RC TWO_Q(BM_BufferPool *const bm, BM_PageHandle *const page, const  PageNumber pageNum);
+void ghostPush(Linkedlist *pg, ghostList *lst, PageNumber pageNum);
+void ghostRemove(Linkedlist *pg, ghostEntry *entry);
+ghostEntry *findGhost(Linkedlist *pg, PageNumber pageNum);
+void forgetGhost(Linkedlist *pg, PageNumber pageNum);
+pageFrame *listVictim(frameList *lst);
+pageFrame *getFreeFrame(Linkedlist *pg);
+RC releaseFrame(BM_BufferPool *const bm, pageFrame *frame);
+pageFrame *selectVictim(BM_BufferPool *const bm);
+void readmitFrame(BM_BufferPool *const bm, pageFrame *frame);
+pageFrame *fifoVictim(Linkedlist *pg);
+pageFrame *clockVictim(Linkedlist *pg);
+pageFrame *lruVictim(Linkedlist *pg);
+pageFrame *lrukVictim(Linkedlist *pg);
+pageFrame *lfuVictim(Linkedlist *pg);
+pageFrame *twoQVictim(Linkedlist *pg);
+RC shrinkPool(BM_BufferPool *const bm);
+RC registerPool(BM_BufferPool *const bm);
+void unregisterPool(BM_BufferPool *const bm);
+void initStrategy(Linkedlist *lst, ReplacementStrategy strategy, void *stratData, int numPages);
+void freeStrategy(Linkedlist *lst);
+void heapPush(Linkedlist *pg, pageFrame *frame);
+pageFrame *heapPop(Linkedlist *pg);
+void heapSiftDown(Linkedlist *pg, int pos);
+void loadFrame(BM_BufferPool *const bm, pageFrame *current, BM_PageHandle *const page, const PageNumber pageNum);
+RC loadPage(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum);
+void hitFrame(BM_BufferPool *const bm, pageFrame *current);
+void deferHit(BM_BufferPool *const bm, pageFrame *current, PageNumber pageNum);
+void drainHits(BM_BufferPool *const bm);
+RC fillFrame(Linkedlist *pg, pageFrame *current, PageNumber pageNum, bool submit, bool *submitted);
+pageFrame *pinResident(Linkedlist *pg, PageNumber pageNum);
+void unpinFrame(Linkedlist *pg, pageFrame *frame);
+void wakeWaiters(Linkedlist *pg);
+RC writeFrame(Linkedlist *pg, pageFrame *frame);
+void initShards(Linkedlist *lst, int numShards, int numPages);
+void startCleaner(BM_BufferPool *const bm);
+void stopCleaner(Linkedlist *pg);
+int collectDirty(BM_BufferPool *const bm, int max);
+int cleanPages(BM_BufferPool *const bm);
+int finishWrites(Linkedlist *pg, int minWait);
+int finishReads(Linkedlist *pg, int minWait);
+void freeShards(Linkedlist *lst);
+void initPageTable(pageTable *pt, int numPages);
+void freePageTable(pageTable *pt);
+int lookupPage(pageTable *pt, PageNumber pageNum);
+void insertPage(pageTable *pt, PageNumber pageNum, int frameIdx);
+void removePage(pageTable *pt, PageNumber pageNum);
+pageFrame *findFrame(Linkedlist *pg, PageNumber pageNum);
+char *allocArena(size_t *size);
+void listPushFront(frameList *lst, pageFrame *frame);
+void listRemove(frameList *lst, pageFrame *frame);
 
 /****************************************************************
- *Function Name: initPageFrame
+ *Function Name: initPageTable
  *
- * Description: Initialise pageframe of size numPages
+ * Description: Initialise page table with at least twice as many
+ *              slots as frames so probe sequences stay short
  *
  * Parameter:
- *        Linkedlist *lstPtr
+ *        pageTable *pt
+ *        int numPages
  *
  * Return:
  *    void
  ***************************************************************/
-void initPageFrame(Linkedlist *lstPtr){
-    //create new pageFrame
-    pageFrame *new = (pageFrame*)malloc(sizeof(pageFrame));
-    wrt=0;
-    rd=0;
-    new->data= NULL;
-    new->pageNo= NO_PAGE;
-    new->fixcount= 0;
-    new->dirtyBit=0;
-    new->val=0;
-    //add new pageframe at tail make next pointer to point to head
-    if(lstPtr->nodeCount==0){
-        new->next=new;
-        lstPtr->head=new;
-    }
-    else{
-        lstPtr->tail->next=new;
-        new->next=lstPtr->head;
-    }
-    lstPtr->tail=new;
-    lstPtr->nodeCount++;
-    
+void initPageTable(pageTable *pt, int numPages){
+    int i,size=8;
+    while(size< 2*numPages)
+        size=size*2;
+    pt->pageNo=(PageNumber*)malloc(sizeof(PageNumber)*size);
+    pt->frameIdx=(int*)malloc(sizeof(int)*size);
+    pt->mask=size-1;
+    //mark all slots empty
+    for(i=0;i<size;i++)
+        pt->pageNo[i]=NO_PAGE;
 }
 
 /****************************************************************
- *Function Name: initBufferPool
+ *Function Name: freePageTable
  *
- * Description: Initialise Buffer Pool manager
+ * Description: Free memory allocated to page table
  *
  * Parameter:
- *        BM_BufferPool *const bm
- *        const char *const pageFileName
- *        const int numPages
- *        ReplacementStrategy strategy
- *        void *stratData
+ *        pageTable *pt
  *
  * Return:
- *     RC: returned code
+ *    void
  ***************************************************************/
-RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, const int numPages, ReplacementStrategy strategy, void *stratData){
-    
-    int i;
-    bufSize=numPages;
-    fHandle=(SM_FileHandle*)malloc(sizeof(SM_FileHandle));
-    Linkedlist *lst= (Linkedlist*)malloc(sizeof(Linkedlist)*numPages);
-    lst->head=NULL;
-    lst->tail=NULL;
-    lst->curPos=NULL;
-    lst->nodeCount=0;
-    if(openPageFile((char*)pageFileName,fHandle)== RC_OK){
-        //initialise Page frame
-        for(i=0;i< numPages; i++)
-            initPageFrame(lst);
-        //initialis buffer pool
-        lst->curPos=lst->head;
-        bm->pageFile= (char*)pageFileName;
-        bm->numPages=numPages;
-        bm->strategy= strategy;
-        bm->mgmtData= lst;
-        
-        return RC_OK;
-    }
-    return RC_FILE_NOT_FOUND;
+void freePageTable(pageTable *pt){
+    free(pt->pageNo);
+    free(pt->frameIdx);
+    pt->pageNo=NULL;
+    pt->frameIdx=NULL;
 }
 
 /****************************************************************
- *Function Name: shutdownBufferPool
+ *Function Name: hashPage
  *
- * Description: Free up all resources allocated to Buffer Pool manager
+ * Description: Returns home slot of page number (multiplicative hashing)
  *
  * Parameter:
- *        BM_BufferPool *const bm
- *
+ *        pageTable *pt
+ *        PageNumber pageNum
  *
  * Return:
- *     RC: returned code
+ *    int
  ***************************************************************/
-RC shutdownBufferPool( BM_BufferPool *const bm){
-    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
-    pageFrame *current= (pageFrame*)pg->head;
-    pageFrame *cur;
-    int i;
-    forceFlushPool(bm);
-    //Iterate through buffer and return error there are pinned pages
-    do{
-        if(current->fixcount!=0){
-            return RC_PINNED_NOT_OUT;
-        }
-        current=current->next;
-    }while(current!=pg->head);
-    //free up all the resources allocated
-    bm->mgmtData=NULL;
-    for(i=0;i<bufSize-1;i++){
-        cur=pg->head->next;
-        free(pg->head);
-        pg->head=cur;
-    }
-    //free(pg->head);
-    free(bm->mgmtData);
-    closePageFile (fHandle);
-    free(fHandle);
-    return RC_OK;
+static int hashPage(pageTable *pt, PageNumber pageNum){
+    unsigned long long h=(unsigned long long)pageNum*11400714819323198485ull;
+    return (int)((h>>32) & (unsigned int)pt->mask);
 }
+
 /****************************************************************
- *Function Name: forceFlushPool
+ *Function Name: lookupPage
  *
- * Description: Flushes all dirty pages with fixcount zero back to disk
+ * Description: Returns frame index holding page pageNum or -1
  *
  * Parameter:
- *        BM_BufferPool *const bm
- *
+ *        pageTable *pt
+ *        PageNumber pageNum
  *
  * Return:
- *     RC: returned code
+ *    int
  ***************************************************************/
-RC forceFlushPool(BM_BufferPool *const bm){
-    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
-    pageFrame *current= (pageFrame*)pg->head;
-    ////Iterate through buffer and find page with fixcount zero and dirty bit=1 and reset it
-    do{
-        if(current->fixcount==0 && current->dirtyBit==1){
-            writeBlock(current->pageNo,fHandle,current->data);
-            wrt++;
-            current->dirtyBit=0;
-            
-        }
-        current=current->next;
-    }while(current!=pg->head);
-    
-    return RC_OK;
+int lookupPage(pageTable *pt, PageNumber pageNum){
+    int slot=hashPage(pt,pageNum);
+    //linear probing until page or empty slot is found
+    while(pt->pageNo[slot]!=NO_PAGE){
+        if(pt->pageNo[slot]==pageNum)
+            return pt->frameIdx[slot];
+        slot=(slot+1) & pt->mask;
+    }
+    return -1;
 }
 
 /****************************************************************
- *Function Name: markDirty
+ *Function Name: insertPage
  *
- * Description: Marks page as dirty
+ * Description: Map page pageNum to frame frameIdx
  *
  * Parameter:
- *        BM_BufferPool *const bm
- *        BM_PageHandle *const page
+ *        pageTable *pt
+ *        PageNumber pageNum
+ *        int frameIdx
  *
  * Return:
- *     RC: returned code
+ *    void
  ***************************************************************/
-RC markDirty(BM_BufferPool *const bm, BM_PageHandle *const page){
-    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
-    pageFrame *current= (pageFrame*)pg->head;
-    //Iterate through buffer and find page with pageNum and set the dirty bit
-    do{
-        if(current->pageNo==page->pageNum){
-            current->dirtyBit=1;
-            return RC_OK;
-        }
-        current=current->next;
-    }while(current!=pg->head);
-    return RC_NO_FILENAME;
+void insertPage(pageTable *pt, PageNumber pageNum, int frameIdx){
+    int slot=hashPage(pt,pageNum);
+    while(pt->pageNo[slot]!=NO_PAGE && pt->pageNo[slot]!=pageNum)
+        slot=(slot+1) & pt->mask;
+    pt->pageNo[slot]=pageNum;
+    pt->frameIdx[slot]=frameIdx;
 }
 
 /****************************************************************
- *Function Name: unpinPage
+ *Function Name: removePage
  *
- * Description: unpin pages in buffer
+ * Description: Remove mapping of page pageNum. Entries after the
+ *              freed slot are shifted back so no tombstones are needed
  *
  * Parameter:
- *        BM_BufferPool *const bm
- *        BM_PageHandle *const page
+ *        pageTable *pt
+ *        PageNumber pageNum
  *
  * Return:
- *     RC: returned code
+ *    void
  ***************************************************************/
-RC unpinPage(BM_BufferPool *const bm, BM_PageHandle *const page){
-    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
-    pageFrame *current= (pageFrame*)pg->head;
-    //Iterate through buffer and find page with pageNum and decrease fixcount
-    do{
-        if(current->pageNo==page->pageNum){
-            current->fixcount--;
-            break;
-            
+void removePage(pageTable *pt, PageNumber pageNum){
+    int slot=hashPage(pt,pageNum);
+    int next,home;
+    while(pt->pageNo[slot]!=pageNum){
+        if(pt->pageNo[slot]==NO_PAGE)
+            return;
+        slot=(slot+1) & pt->mask;
+    }
+    pt->pageNo[slot]=NO_PAGE;
+    next=(slot+1) & pt->mask;
+    while(pt->pageNo[next]!=NO_PAGE){
+        home=hashPage(pt,pt->pageNo[next]);
+        //move entry back if the freed slot lies on its probe path
+        if(((next-home) & pt->mask) >= ((next-slot) & pt->mask)){
+            pt->pageNo[slot]=pt->pageNo[next];
+            pt->frameIdx[slot]=pt->frameIdx[next];
+            pt->pageNo[next]=NO_PAGE;
+            slot=next;
         }
-        current=current->next;
-    }while(current!=pg->head);
-    return RC_OK;
+        next=(next+1) & pt->mask;
+    }
 }
 
 /****************************************************************
- *Function Name: forcePage
+ *Function Name: shardOf
  *
- * Description: write pages back to the pagefile on disk and reset dirty bit
+ * Description: Returns page table shard of page pageNum. Consecutive
+ *              pages go to different shards
  *
  * Parameter:
- *        BM_BufferPool *const bm
- *        BM_PageHandle *const page
+ *        Linkedlist *pg
+ *        PageNumber pageNum
  *
  * Return:
- *     RC: returned code
+ *    tableShard*
  ***************************************************************/
-RC forcePage(BM_BufferPool *const bm, BM_PageHandle *const page){
-    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
-    pageFrame *current= (pageFrame*)pg->head;
-    //current->data = (SM_PageHandle) malloc(PAGE_SIZE);
-    //Iterate through buffer and find page with pageNum and reset dirty bit
-    do{
-        if(current->pageNo==page->pageNum){
-            writeBlock(page->pageNum,fHandle,page->data);
-            wrt++;
-            current->dirtyBit=0;
-            current->fixcount=0;
-            
-        }
-        current=current->next;
-    }while(current!=pg->head);
-    return RC_OK;
+static tableShard *shardOf(Linkedlist *pg, PageNumber pageNum){
+    return &pg->shards[(unsigned int)pageNum & (unsigned int)(pg->numShards-1)];
 }
 
 /****************************************************************
- *Function Name: pinPage
+ *Function Name: latch / unlatch
  *
- * Description: pin page with page number pageNum
+ * Description: Lock and unlock mutex m if the pool is concurrent
  *
  * Parameter:
- *        BM_BufferPool *const bm
- *        BM_PageHandle *const page
- *        PageNumber pageNum
+ *        Linkedlist *pg
+ *        pthread_mutex_t *m
  *
  * Return:
- *     RC: returned code
+ *    void
  ***************************************************************/
-RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page, const  PageNumber pageNum){
-    if(bm->strategy==RS_FIFO)
-        FIFO( bm, page, pageNum);
-    if(bm->strategy==RS_LRU)
-        LRU(bm, page,pageNum);
-    
-    return RC_OK;
+static void latch(Linkedlist *pg, pthread_mutex_t *m){
+    if(pg->concurrent)
+        pthread_mutex_lock(m);
+}
+
+static void unlatch(Linkedlist *pg, pthread_mutex_t *m){
+    if(pg->concurrent)
+        pthread_mutex_unlock(m);
 }
 
 /****************************************************************
- *Function Name: getFrameContents
+ *Function Name: latchIO / unlatchIO
  *
- * Description: returns an array of page number in buffer
+ * Description: Take and release the I/O latch of a concurrent pool.
+ *              Misses hold it shared while they write back and read
+ *              pages outside the evict latch; forceFlushPool, forcePage,
+ *              allocatePoolPage and freePoolPage take it exclusive under
+ *              the evict latch to wait for those I/Os
  *
  * Parameter:
- *        BM_BufferPool *const bm
+ *        Linkedlist *pg
+ *        bool exclusive
  *
  * Return:
- *     PageNumber
+ *    void
  ***************************************************************/
-PageNumber *getFrameContents (BM_BufferPool *const bm)
-{
-    int *frameContents = (int*)malloc(sizeof(int) * bm->numPages);
-    int i=0;
-    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
-    pageFrame *current= (pageFrame*)pg->head;
-    //Iterate through buffer
-    do{
-        frameContents[i]=current->pageNo;
-        i++;
-        
-        current =current->next;
-    }while(current!=pg->head);
-    return frameContents;
-    
-    
+static void latchIO(Linkedlist *pg, bool exclusive){
+    if(pg->concurrent && exclusive)
+        pthread_rwlock_wrlock(&pg->ioLatch);
+    else if(pg->concurrent)
+        pthread_rwlock_rdlock(&pg->ioLatch);
+}
+
+static void unlatchIO(Linkedlist *pg){
+    if(pg->concurrent)
+        pthread_rwlock_unlock(&pg->ioLatch);
 }
 
 /****************************************************************
- *Function Name: getDirtyFlags
+ *Function Name: claimFrame
  *
- * Description: returns an array of dirty bit in pageFrame
+ * Description: Take unpinned frame for replacement by setting its
+ *              fixcount from 0 to -1, so no other thread can pin it
  *
  * Parameter:
- *        BM_BufferPool *const bm
- *
+ *        pageFrame *frame
  *
  * Return:
- *     bool
+ *    bool: true if frame was unpinned
  ***************************************************************/
-bool *getDirtyFlags (BM_BufferPool *const bm)
-{
-    bool *dirtyFlags = (bool*)malloc(sizeof(bool) * bm->numPages);
-    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
-    pageFrame *current= (pageFrame*)pg->head;
-    
-    int i=0;
-    //Iterate through buffer
-    do{
-        dirtyFlags[i]=current->dirtyBit;
-        i++;
-        
-        current=current->next;
-    }while(current!=pg->head);
-    return dirtyFlags;
+static bool claimFrame(pageFrame *frame){
+    int count=0;
+    return __atomic_compare_exchange_n(&frame->fixcount,&count,-1,false,__ATOMIC_SEQ_CST,__ATOMIC_RELAXED);
 }
 
 /****************************************************************
- *Function Name: getFixCounts
+ *Function Name: clearDirty
  *
- * Description: returns an array of fix count of pages in PageFrame
+ * Description: Reset dirty bit of frame and keep count of the dirty
+ *              frames of the pool
  *
  * Parameter:
- *        BM_BufferPool *const bm
+ *        Linkedlist *pg
+ *        pageFrame *frame
  *
  * Return:
- *     int
+ *    bool: true if frame was dirty and has to be written
  ***************************************************************/
-int *getFixCounts (BM_BufferPool *const bm)
-{
-    int *fixCounts = (int*)malloc(sizeof(int) * bm->numPages);
-    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
-    pageFrame *current= (pageFrame*)pg->head;
-    int i = 0;
-    //Iterate through buffer
-    do{
-        fixCounts[i]=current->fixcount;
-        i++;
-        
-        current=current->next;
-    }while(current!=pg->head);
-    return fixCounts;
-    
-    
+static bool clearDirty(Linkedlist *pg, pageFrame *frame){
+    if(!__atomic_exchange_n(&frame->dirtyBit,0,__ATOMIC_ACQ_REL))
+        return false;
+    __atomic_sub_fetch(&pg->numDirty,1,__ATOMIC_RELAXED);
+    return true;
 }
 
 /****************************************************************
- *Function Name: getNunReadIO
+ *Function Name: restoreDirty
  *
- * Description: Returns number of pages read from disk
+ * Description: Set dirty bit of frame again after its write failed,
+ *              unless a thread marked it dirty meanwhile
  *
  * Parameter:
- *        BM_BufferPool *const bm
+ *        Linkedlist *pg
+ *        pageFrame *frame
  *
  * Return:
- *     int
+ *    void
  ***************************************************************/
-int getNumReadIO (BM_BufferPool *const bm)
-{
-    int readIO;
-    if(bm->strategy==RS_FIFO){
-        readIO=rd;
-    }
-    if(bm->strategy==RS_LRU){
-        readIO=10;
-    }
-    return readIO;
+static void restoreDirty(Linkedlist *pg, pageFrame *frame){
+    if(!__atomic_exchange_n(&frame->dirtyBit,1,__ATOMIC_ACQ_REL))
+        __atomic_add_fetch(&pg->numDirty,1,__ATOMIC_RELAXED);
 }
 
 /****************************************************************
- *Function Name: getWriteIO
+ *Function Name: findFrame
  *
- * Description: Returns number of written back to page file
+ * Description: Returns frame holding page pageNum or NULL. In
+ *              concurrent mode the caller holds the latch of the shard
  *
  * Parameter:
- *        BM_BufferPool *const bm
+ *        Linkedlist *pg
+ *        PageNumber pageNum
  *
  * Return:
- *     int
+ *    pageFrame*
  ***************************************************************/
-int getNumWriteIO (BM_BufferPool *const bm)
-{    int wrtCount;
-    if(bm->strategy==RS_FIFO){
-        wrtCount=wrt;
-    }
-    if(bm->strategy==RS_LRU){
-        wrtCount=0;
-    }
-    return wrtCount;
+pageFrame *findFrame(Linkedlist *pg, PageNumber pageNum){
+    int idx=lookupPage(&shardOf(pg,pageNum)->table,pageNum);
+    if(idx==-1)
+        return NULL;
+    return &pg->frames[idx];
 }
 
 /****************************************************************
- *Function Name: FIFO
+ *Function Name: listPushFront
  *
- * Description: Implements first in first out strategy
+ * Description: Add frame at most recently used end of list
  *
  * Parameter:
- *        BM_BufferPool *const bm
- *        BM_PageHandle *const page
- *        PageNumber pageNum
+ *        frameList *lst
+ *        pageFrame *frame
  *
  * Return:
- *     void
+ *    void
  ***************************************************************/
-void FIFO(BM_BufferPool *const bm, BM_PageHandle *const page, const  PageNumber pageNum){
-    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
-    pageFrame *current= (pageFrame*)pg->head;
-    //Check if buffer is empty and load page from disk
-    
-    if(current->pageNo==NO_PAGE){
-        current->pageNo=pageNum;
-        current->fixcount=1;
-        page->data=(SM_PageHandle)calloc(sizeof(char),4096);
-        readBlock(pageNum,fHandle,page->data);
-        rd++;
-        current->data=page->data;
-        
-        page->pageNum= pageNum;
-        
-        return;
-    }
-    else{
-        do{ //check if page number already exist
-            if(current->pageNo==pageNum){
-                current->fixcount++;
-                page->pageNum= pageNum;
-                page->data=current->data;
-                
-                return;
-            }
-            current=current->next;
-        }while(current!=pg->head);
-        do{
-            if(current->pageNo==NO_PAGE){
-                current->pageNo=pageNum;
-                current->fixcount++;
-                page->pageNum= pageNum;
-                page->data=(SM_PageHandle)calloc(sizeof(char),4096);
-                readBlock(pageNum,fHandle,page->data);
-                rd++;
-                current->data=page->data;
-                pg->curPos=current;
-                return;
-                
-            }
-            current=current->next;
-        }while(current!=pg->head);
-        
-        
-    }
-    //when the buffer is full, replace page
-    current=pg->curPos->next;
-    do{
-        if(current->fixcount!=0){
-            pg->curPos=current;
-        }
-        else if(current->fixcount==0)
-            break;
-        current=current->next;
-    }while(current!=pg->head);
-    page->data=current->data;
-    page->pageNum=current->pageNo;
-    if(current->dirtyBit==1)
-        forcePage(bm,page);
-    current->fixcount=0;
-    current->pageNo=pageNum;
-    current->fixcount++;
-    page->pageNum= pageNum;
-    readBlock(pageNum,fHandle,page->data);
-    rd++;
-    current->data=page->data;
-    pg->curPos=current;
-    return;
-    
-    
+void listPushFront(frameList *lst, pageFrame *frame){
+    frame->owner=lst;
+    frame->lruPrev=NULL;
+    frame->lruNext=lst->first;
+    if(lst->first!=NULL)
+        lst->first->lruPrev=frame;
+    else
+        lst->last=frame;
+    lst->first=frame;
+    lst->size++;
 }
 
-
-
 /****************************************************************
- *Function Name: LRU
+ *Function Name: listRemove
  *
- * Description: Replace place which has not been accessed recently
+ * Description: Unlink frame from list
  *
  * Parameter:
- *        BM_BufferPool *const bm
- *        BM_PageHandle *const page
- *        PageNumber pageNum
+ *        frameList *lst
+ *        pageFrame *frame
  *
  * Return:
- *     void
+ *    void
  ***************************************************************/
+void listRemove(frameList *lst, pageFrame *frame){
+    if(frame->lruPrev!=NULL)
+        frame->lruPrev->lruNext=frame->lruNext;
+    else
+        lst->first=frame->lruNext;
+    if(frame->lruNext!=NULL)
+        frame->lruNext->lruPrev=frame->lruPrev;
+    else
+        lst->last=frame->lruPrev;
+    frame->lruPrev=NULL;
+    frame->lruNext=NULL;
+    frame->owner=NULL;
+    lst->size--;
+}
 
-void LRU(BM_BufferPool *const bm, BM_PageHandle *const page, const  PageNumber pageNum){
-    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
-    pageFrame *current= (pageFrame*)pg->head;
-    
-    if(current->pageNo==NO_PAGE){
-        current->pageNo=pageNum;
-        current->fixcount=1;
-        page->data=(SM_PageHandle)calloc(sizeof(char),4096);
-        sprintf(page->data, "%s-%d", "Page", pageNum);
-        page->pageNum= pageNum;
-        current->val++;
-        free(page->data);
-        
-        return;
+/****************************************************************
+ *Function Name: listVictim
+ *
+ * Description: Claims least recently used unpinned frame of list and
+ *              returns it, NULL if all its frames are pinned
+ *
+ * Parameter:
+ *        frameList *lst
+ *
+ * Return:
+ *    pageFrame*
+ ***************************************************************/
+pageFrame *listVictim(frameList *lst){
+    pageFrame *current=lst->last;
+    while(current!=NULL && !claimFrame(current))
+        current=current->lruPrev;
+    return current;
+}
+
+/****************************************************************
+ *Function Name: getFreeFrame
+ *
+ * Description: Returns an empty frame, claimed like a victim, or NULL
+ *              if there is none or the pool already holds as many pages
+ *              as its quota allows
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *
+ * Return:
+ *    pageFrame*
+ ***************************************************************/
+pageFrame *getFreeFrame(Linkedlist *pg){
+    pageFrame *frame;
+    if(pg->numFree==0 || pg->numResident>=__atomic_load_n(&pg->quota,__ATOMIC_RELAXED))
+        return NULL;
+    pg->numResident++;
+    frame=&pg->frames[pg->freeFrames[--pg->numFree]];
+    //a prefetch read into the frame is in flight until finishReads, no victim search may take it
+    __atomic_store_n(&frame->fixcount,-1,__ATOMIC_RELAXED);
+    return frame;
+}
+
+/****************************************************************
+ *Function Name: releaseFrame
+ *
+ * Description: Write back page held in frame if it is dirty, empty the
+ *              frame and give its memory back to the system unless the
+ *              arena is backed by huge pages. The frame must already be
+ *              claimed and removed from the strategy bookkeeping. If the
+ *              write fails the page stays in the frame, dirty, and is
+ *              handed back to the strategy
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *        pageFrame *frame
+ *
+ * Return:
+ *    RC: returned code, the error of the write if it failed
+ ***************************************************************/
+RC releaseFrame(BM_BufferPool *const bm, pageFrame *frame){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    tableShard *shard=shardOf(pg,frame->pageNo);
+    RC rc;
+    //pins of the page wait while the frame is claimed
+    if(clearDirty(pg,frame) && (rc=writeFrame(pg,frame))!=RC_OK){
+        restoreDirty(pg,frame);
+        readmitFrame(bm,frame);
+        __atomic_store_n(&frame->fixcount,0,__ATOMIC_RELEASE);
+        return rc;
     }
-    if(current->pageNo!=NO_PAGE){
-        do{
-            if(current->pageNo==pageNum){
-                current->fixcount++;
-                page->pageNum= pageNum;
-                //page->data=(SM_PageHandle)calloc(sizeof(char),4096);
-                //page->data=current->data;
-                sprintf(page->data, "%s-%d", "Page", pageNum);
-                //free(page->data);
-                return;
-            }
-            current=current->next;
-        }while(current!=pg->head);
-        do{
-            if(current->pageNo==NO_PAGE){
-                //char *info=(SM_PageHandle)calloc(sizeof(char),4096);
-                current->pageNo=pageNum;
-                current->fixcount++;
-                page->pageNum= pageNum;
-                //page->data=info;
-                sprintf(page->data, "%s-%d", "Page", pageNum);
-                pg->curPos=current;
-                //free(info);
-                return;
-                
+    latch(pg,&shard->latch);
+    removePage(&shard->table,frame->pageNo);
+    unlatch(pg,&shard->latch);
+    __atomic_store_n(&frame->pageNo,NO_PAGE,__ATOMIC_RELAXED);
+    frame->refBit=0;
+    pg->freeFrames[pg->numFree++]=frame-pg->frames;
+    pg->numResident--;
+    __atomic_store_n(&frame->fixcount,0,__ATOMIC_RELEASE);
+    //slot stays reserved in the arena, the pages behind it are dropped; dropping
+    //part of a huge page would split it, so huge page arenas keep their memory
+    if(pg->arenaSize<HUGE_PAGE_SIZE)
+        madvise(frame->data,pg->fHandle->pageSize,MADV_DONTNEED);
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: allocArena
+ *
+ * Description: Reserve one page aligned block of memory holding all
+ *              frames of the pool. Large arenas are rounded up to whole
+ *              huge pages; with BM_USE_HUGETLB explicit huge pages are
+ *              tried first, otherwise transparent huge pages are requested
+ *
+ * Parameter:
+ *        size_t *size
+ *
+ * Return:
+ *    char*: arena or NULL
+ ***************************************************************/
+char *allocArena(size_t *size){
+    void *arena=MAP_FAILED;
+    if(*size>=HUGE_PAGE_SIZE)
+        *size=(*size+HUGE_PAGE_SIZE-1)/HUGE_PAGE_SIZE*HUGE_PAGE_SIZE;
+#if defined(BM_USE_HUGETLB) && defined(MAP_HUGETLB)
+    if(*size>=HUGE_PAGE_SIZE)
+        arena=mmap(NULL,*size,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB,-1,0);
+#endif
+    if(arena==MAP_FAILED){
+        arena=mmap(NULL,*size,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+        if(arena==MAP_FAILED)
+            return NULL;
+#ifdef MADV_HUGEPAGE
+        if(*size>=HUGE_PAGE_SIZE)
+            madvise(arena,*size,MADV_HUGEPAGE);
+#endif
+    }
+    return (char*)arena;
+}
+
+/****************************************************************
+ *Function Name: initStrategy
+ *
+ * Description: Initialise bookkeeping of replacement strategy. For
+ *              RS_LRU_K stratData may point to BM_LRUKParams, otherwise
+ *              K=2 without correlated reference period is used. For
+ *              RS_LFU it may point to BM_LFUParams, otherwise no aging.
+ *              For RS_2Q it may point to BM_2QParams, otherwise a
+ *              quarter of the frames are used for A1in and the ghost
+ *              list remembers half as many pages as there are frames
+ *
+ * Parameter:
+ *        Linkedlist *lst
+ *        ReplacementStrategy strategy
+ *        void *stratData
+ *        int numPages
+ *
+ * Return:
+ *    void
+ ***************************************************************/
+void initStrategy(Linkedlist *lst, ReplacementStrategy strategy, void *stratData, int numPages){
+    int i;
+    lst->heap=NULL;
+    lst->skipped=NULL;
+    lst->heapSize=0;
+    lst->histArena=NULL;
+    lst->timeStamp=0;
+    lst->bucketArena=NULL;
+    lst->freeBuckets=NULL;
+    lst->minBucket=NULL;
+    lst->agingPeriod=0;
+    memset(&lst->recent,0,sizeof(frameList));
+    memset(&lst->frequent,0,sizeof(frameList));
+    memset(&lst->ghostRecent,0,sizeof(ghostList));
+    memset(&lst->ghostFrequent,0,sizeof(ghostList));
+    lst->ghostArena=NULL;
+    lst->freeGhosts=NULL;
+    lst->ghostTable.pageNo=NULL;
+    lst->ghostTable.frameIdx=NULL;
+    lst->arcTarget=0;
+    lst->kin=0;
+    lst->kout=0;
+    if(strategy==RS_LRU_K){
+        BM_LRUKParams *params=(BM_LRUKParams*)stratData;
+        lst->k=2;
+        lst->correlatedPeriod=0;
+        if(params!=NULL){
+            if(params->k>0)
+                lst->k=params->k;
+            if(params->correlatedPeriod>0)
+                lst->correlatedPeriod=params->correlatedPeriod;
+        }
+        lst->heap=(pageFrame**)malloc(sizeof(pageFrame*)*numPages);
+        lst->skipped=(pageFrame**)malloc(sizeof(pageFrame*)*numPages);
+        lst->histArena=(long*)calloc((size_t)numPages*lst->k,sizeof(long));
+        for(i=0;i<numPages;i++)
+            lst->frames[i].hist=lst->histArena+(size_t)i*lst->k;
+    }
+    if(strategy==RS_LFU){
+        if(stratData!=NULL && ((BM_LFUParams*)stratData)->agingPeriod>0)
+            lst->agingPeriod=((BM_LFUParams*)stratData)->agingPeriod;
+        //there are never more distinct frequencies than frames
+        lst->bucketArena=(freqBucket*)malloc(sizeof(freqBucket)*numPages);
+        for(i=0;i<numPages;i++){
+            lst->bucketArena[i].next=lst->freeBuckets;
+            lst->freeBuckets=&lst->bucketArena[i];
+        }
+    }
+    if(strategy==RS_ARC || strategy==RS_2Q){
+        //ARC remembers as many replaced pages as there are frames
+        lst->kout=numPages;
+        if(strategy==RS_2Q){
+            BM_2QParams *params=(BM_2QParams*)stratData;
+            lst->kin= numPages/4>0 ? numPages/4 : 1;
+            lst->kout= numPages/2>0 ? numPages/2 : 1;
+            if(params!=NULL){
+                if(params->kin>0)
+                    lst->kin=params->kin;
+                if(params->kout>0)
+                    lst->kout=params->kout;
             }
-            current=current->next;
-        }while(current!=pg->head);
-        
-        
+        }
+        lst->ghostArena=(ghostEntry*)malloc(sizeof(ghostEntry)*lst->kout);
+        for(i=0;i<lst->kout;i++){
+            lst->ghostArena[i].next=lst->freeGhosts;
+            lst->freeGhosts=&lst->ghostArena[i];
+        }
+        initPageTable(&lst->ghostTable,lst->kout);
+    }
+}
+
+/****************************************************************
+ *Function Name: freeStrategy
+ *
+ * Description: Free bookkeeping of replacement strategy
+ *
+ * Parameter:
+ *        Linkedlist *lst
+ *
+ * Return:
+ *    void
+ ***************************************************************/
+void freeStrategy(Linkedlist *lst){
+    free(lst->heap);
+    free(lst->skipped);
+    free(lst->histArena);
+    free(lst->bucketArena);
+    free(lst->ghostArena);
+    if(lst->ghostTable.pageNo!=NULL)
+        freePageTable(&lst->ghostTable);
+}
+
+/****************************************************************
+ *Function Name: initPageFrame
+ *
+ * Description: Initialise pageframe of size numPages
+ *
+ * Parameter:
+ *        Linkedlist *lstPtr
+ *
+ * Return:
+ *    void
+ ***************************************************************/
+void initPageFrame(Linkedlist *lstPtr){
+    //take next pageFrame from frame array
+    pageFrame *new = &lstPtr->frames[lstPtr->nodeCount];
+    //each frame owns a fixed slot of the arena
+    new->data= lstPtr->arena+(size_t)lstPtr->nodeCount*lstPtr->fHandle->pageSize;
+    new->pageNo= NO_PAGE;
+    new->fixcount= 0;
+    new->dirtyBit=0;
+    new->corrupt=0;
+    new->val=0;
+    new->refBit=0;
+    new->lruPrev=NULL;
+    new->lruNext=NULL;
+    new->hist=NULL;
+    new->last=0;
+    new->heapPos=-1;
+    new->freq=0;
+    new->bucket=NULL;
+    new->owner=NULL;
+    //add new pageframe at tail make next pointer to point to head
+    if(lstPtr->nodeCount==0){
+        new->next=new;
+        lstPtr->head=new;
+    }
+    else{
+        lstPtr->tail->next=new;
+        new->next=lstPtr->head;
+    }
+    lstPtr->tail=new;
+    lstPtr->nodeCount++;
+    
+}
+
+/****************************************************************
+ *Function Name: initShards
+ *
+ * Description: Initialise numShards page table shards and the latches
+ *              of the pool. Every shard can hold two pages per frame,
+ *              since all pages in the buffer may fall into the same
+ *              shard and a frame being reused maps its old and new page
+ *
+ * Parameter:
+ *        Linkedlist *lst
+ *        int numShards
+ *        int numPages
+ *
+ * Return:
+ *    void
+ ***************************************************************/
+void initShards(Linkedlist *lst, int numShards, int numPages){
+    int i;
+    lst->numShards=numShards;
+    lst->shards=(tableShard*)aligned_alloc(__alignof__(tableShard),sizeof(tableShard)*numShards);
+    for(i=0;i<numShards;i++){
+        pthread_mutex_init(&lst->shards[i].latch,NULL);
+        initPageTable(&lst->shards[i].table,2*numPages);
+        lst->shards[i].pins=0;
+        lst->shards[i].numHits=0;
+    }
+    pthread_mutex_init(&lst->evictLatch,NULL);
+    pthread_mutex_init(&lst->replLatch,NULL);
+    pthread_rwlock_init(&lst->ioLatch,NULL);
+    pthread_cond_init(&lst->frameFree,NULL);
+    lst->waiters=0;
+    pthread_mutex_init(&lst->cleanerLatch,NULL);
+    pthread_cond_init(&lst->cleanerWake,NULL);
+}
+
+/****************************************************************
+ *Function Name: freeShards
+ *
+ * Description: Free page table shards and latches of the pool
+ *
+ * Parameter:
+ *        Linkedlist *lst
+ *
+ * Return:
+ *    void
+ ***************************************************************/
+void freeShards(Linkedlist *lst){
+    int i;
+    for(i=0;i<lst->numShards;i++){
+        pthread_mutex_destroy(&lst->shards[i].latch);
+        freePageTable(&lst->shards[i].table);
+    }
+    free(lst->shards);
+    pthread_mutex_destroy(&lst->evictLatch);
+    pthread_mutex_destroy(&lst->replLatch);
+    pthread_rwlock_destroy(&lst->ioLatch);
+    pthread_cond_destroy(&lst->frameFree);
+    pthread_mutex_destroy(&lst->cleanerLatch);
+    pthread_cond_destroy(&lst->cleanerWake);
+}
+
+/****************************************************************
+ *Function Name: initBufferPool
+ *
+ * Description: Initialise Buffer Pool manager with default options
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *        const char *const pageFileName
+ *        const int numPages
+ *        ReplacementStrategy strategy
+ *        void *stratData
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, const int numPages, ReplacementStrategy strategy, void *stratData){
+    return initBufferPoolWithOptions(bm,pageFileName,numPages,strategy,stratData,NULL);
+}
+
+/****************************************************************
+ *Function Name: initBufferPoolWithOptions
+ *
+ * Description: Initialise Buffer Pool manager. All state of the pool
+ *              is kept in its mgmtData, so several pools can be open at
+ *              the same time. If a pool registry was set up the pool
+ *              gets its frame quota from the shared budget. With
+ *              options->concurrent the pool may be used by several
+ *              threads; numShards defaults to four per processor. With
+ *              options->cleanerHigh a background writer is started and
+ *              the pool takes its latches even if only one thread uses it.
+ *              options->directIO bypasses the page cache of the system.
+ *              Frames have the page size recorded in the page file
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *        const char *const pageFileName
+ *        const int numPages
+ *        ReplacementStrategy strategy
+ *        void *stratData
+ *        const BM_PoolOptions *options: NULL for defaults
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC initBufferPoolWithOptions(BM_BufferPool *const bm, const char *const pageFileName, const int numPages, ReplacementStrategy strategy, void *stratData, const BM_PoolOptions *options){
+    
+    int i;
+    int numShards=1;
+    RC rc;
+    Linkedlist *lst= (Linkedlist*)malloc(sizeof(Linkedlist));
+    lst->fHandle=(SM_FileHandle*)malloc(sizeof(SM_FileHandle));
+    lst->numReadIO=0;
+    lst->numWriteIO=0;
+    lst->blocking= options!=NULL && options->concurrent;
+    lst->checksums= options!=NULL && options->checksums;
+    lst->concurrent= lst->blocking || (options!=NULL && options->cleanerHigh>0);
+    lst->numDirty=0;
+    lst->cleanerHigh=0;
+    lst->cleanerLow=0;
+    lst->cleanerPins=0;
+    lst->cleanerStop=false;
+    lst->flushThreads= options!=NULL && options->flushThreads>0 ? options->flushThreads : BM_FLUSH_THREADS;
+    if(lst->flushThreads>BM_MAX_FLUSH_THREADS)
+        lst->flushThreads=BM_MAX_FLUSH_THREADS;
+    lst->cleanBatch=NULL;
+    lst->cleanQueue=NULL;
+    lst->ioQueue=NULL;
+    lst->prefetching=false;
+    lst->readsInFlight=0;
+    lst->head=NULL;
+    lst->tail=NULL;
+    lst->curPos=NULL;
+    lst->nodeCount=0;
+    lst->numResident=0;
+    lst->quota=numPages;
+    lst->windowReads=0;
+    lst->lruList.first=NULL;
+    lst->lruList.last=NULL;
+    lst->lruList.size=0;
+    if(openPageFileWithFlags((char*)pageFileName,lst->fHandle,options==NULL ? 0 : (options->directIO ? SM_OPEN_DIRECT : 0)|(options->checksums ? SM_OPEN_CHECKSUM : 0))!= RC_OK){
+        free(lst->fHandle);
+        free(lst);
+        return RC_FILE_NOT_FOUND;
+    }
+    //frames cache the pages read, and misses of several threads are no scan of the
+    //file handle; prefetchPages reads ahead for the pool
+    setReadahead(lst->fHandle,0);
+    if(options!=NULL && setDurability(lst->fHandle,options->durability)!=RC_OK){
+        closePageFile(lst->fHandle);
+        free(lst->fHandle);
+        free(lst);
+        return RC_BAD_DURABILITY;
+    }
+    //frames are slots of the page size of the file, page aligned as direct I/O requires
+    lst->arenaSize=(size_t)numPages*lst->fHandle->pageSize;
+    lst->arena=allocArena(&lst->arenaSize);
+    if(lst->arena==NULL){
+        closePageFile(lst->fHandle);
+        free(lst->fHandle);
+        free(lst);
+        return RC_BUFFER_ALLOC_FAILED;
+    }
+    //initialise Page frame and page table
+    lst->frames=(pageFrame*)malloc(sizeof(pageFrame)*numPages);
+    for(i=0;i< numPages; i++)
+        initPageFrame(lst);
+    //watermarks are percentages of the frames, the writer starts with at least one dirty frame
+    if(options!=NULL && options->cleanerHigh>0){
+        lst->cleanerHigh= numPages*options->cleanerHigh/100>0 ? numPages*options->cleanerHigh/100 : 1;
+        lst->cleanerLow= numPages*options->cleanerLow/100;
+        if(lst->cleanerLow>=lst->cleanerHigh)
+            lst->cleanerLow=lst->cleanerHigh-1;
+        lst->cleanBatch=(PageNumber*)malloc(sizeof(PageNumber)*numPages);
+        initIOQueue(&lst->cleanQueue,BM_IO_DEPTH);
+    }
+    //free frames are handed out in frame order
+    lst->freeFrames=(int*)malloc(sizeof(int)*numPages);
+    for(i=0;i< numPages; i++)
+        lst->freeFrames[i]=numPages-1-i;
+    lst->numFree=numPages;
+    //shard count is a power of two so the shard is a bit mask of the page number
+    if(lst->concurrent){
+        i= options->numShards>0 ? options->numShards : 4*(int)sysconf(_SC_NPROCESSORS_ONLN);
+        while(numShards<i && numShards<1024)
+            numShards=numShards*2;
+    }
+    initShards(lst,numShards,numPages);
+    initStrategy(lst,strategy,stratData,numPages);
+    //initialis buffer pool
+    lst->curPos=lst->head;
+    lst->clockHand=lst->head;
+    bm->pageFile= (char*)pageFileName;
+    bm->numPages=numPages;
+    bm->strategy= strategy;
+    bm->mgmtData= lst;
+    rc=registerPool(bm);
+    if(rc!=RC_OK){
+        bm->mgmtData=NULL;
+        munmap(lst->arena,lst->arenaSize);
+        freeStrategy(lst);
+        free(lst->frames);
+        free(lst->freeFrames);
+        free(lst->cleanBatch);
+        if(lst->cleanQueue!=NULL)
+            shutdownIOQueue(lst->cleanQueue);
+        freeShards(lst);
+        closePageFile(lst->fHandle);
+        free(lst->fHandle);
+        free(lst);
+        return rc;
+    }
+    if(lst->cleanerHigh>0)
+        startCleaner(bm);
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: shutdownBufferPool
+ *
+ * Description: Free up all resources allocated to Buffer Pool manager
+ *              and return its frames to the pool registry. No other
+ *              thread may use the pool any more. The background writer
+ *              is stopped first and started again if pages are pinned
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC shutdownBufferPool( BM_BufferPool *const bm){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    pageFrame *current= (pageFrame*)pg->head;
+    RC rc;
+    if(pg->cleanerHigh>0)
+        stopCleaner(pg);
+    rc=forceFlushPool(bm);
+    if(rc!=RC_OK){
+        if(pg->cleanerHigh>0)
+            startCleaner(bm);
+        return rc;
     }
-    //when the buffer is full, replace page
-    current=pg->curPos->next;
+    //Iterate through buffer and return error there are pinned pages
     do{
         if(current->fixcount!=0){
-            pg->curPos=current;}
-        else if(current->fixcount==0)
-            break;
+            if(pg->cleanerHigh>0)
+                startCleaner(bm);
+            return RC_PINNED_NOT_OUT;
+        }
         current=current->next;
     }while(current!=pg->head);
-    char *info=(SM_PageHandle)calloc(sizeof(char),4096);
-    current->pageNo=pageNum;
-    current->fixcount++;
-    page->pageNum= pageNum;
-    page->data=info;
-    sprintf(page->data, "%s-%d", "Page", pageNum);
-    pg->curPos=current;
-    free(info);
-    return;
-    
-    
+    unregisterPool(bm);
+    //free up all the resources allocated
+    bm->mgmtData=NULL;
+    munmap(pg->arena,pg->arenaSize);
+    freeStrategy(pg);
+    free(pg->frames);
+    free(pg->freeFrames);
+    free(pg->cleanBatch);
+    if(pg->cleanQueue!=NULL)
+        shutdownIOQueue(pg->cleanQueue);
+    if(pg->ioQueue!=NULL)
+        shutdownIOQueue(pg->ioQueue);
+    freeShards(pg);
+    closePageFile (pg->fHandle);
+    free(pg->fHandle);
+    free(pg);
+    return RC_OK;
+}
+/****************************************************************
+ *Function Name: comparePages
+ *
+ * Description: qsort order of frames by the page they hold
+ *
+ * Parameter:
+ *        const void *a
+ *        const void *b
+ *
+ * Return:
+ *    int
+ ***************************************************************/
+static int comparePages(const void *a, const void *b){
+    PageNumber x=(*(pageFrame**)a)->pageNo, y=(*(pageFrame**)b)->pageNo;
+    return x<y ? -1 : x>y;
+}
+
+/****************************************************************
+ *Function Name: flushRuns
+ *
+ * Description: Write runs of a flushJob until none is left, each with
+ *              one writeBlocks call. Pages of a failed write are marked
+ *              dirty again
+ *
+ * Parameter:
+ *        void *arg: flushJob
+ *
+ * Return:
+ *    void*
+ ***************************************************************/
+static void *flushRuns(void *arg){
+    flushJob *job=(flushJob*)arg;
+    Linkedlist *pg=job->pg;
+    SM_PageHandle pages[BM_FLUSH_RUN];
+    pageFrame *frame;
+    int r,first,count,i;
+    RC rc;
+    while((r=__atomic_fetch_add(&job->nextRun,1,__ATOMIC_RELAXED))<job->numRuns){
+        first=job->runStart[r];
+        count=job->runStart[r+1]-first;
+        for(i=0;i<count;i++)
+            pages[i]=job->frames[first+i]->data;
+        rc=writeBlocks(job->frames[first]->pageNo,count,pg->fHandle,pages);
+        for(i=0;i<count;i++){
+            frame=job->frames[first+i];
+            if(rc!=RC_OK){
+                restoreDirty(pg,frame);
+                continue;
+            }
+            __atomic_store_n(&frame->corrupt,0,__ATOMIC_RELAXED);
+            __atomic_fetch_add(&pg->numWriteIO,1,__ATOMIC_RELAXED);
+        }
+        if(rc!=RC_OK)
+            __atomic_store_n(&job->failed,true,__ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+/****************************************************************
+ *Function Name: forceFlushPool
+ *
+ * Description: Flushes all dirty pages with fixcount zero back to disk.
+ *              The pages are sorted and consecutive pages, up to
+ *              BM_FLUSH_RUN, are merged into one vectored write, so the
+ *              flush writes the file front to back in few large I/Os.
+ *              The runs are written by up to flushThreads threads. No
+ *              page is replaced while the pool is flushed, and misses
+ *              still writing back or reading pages are waited for
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *
+ *
+ * Return:
+ *     RC: returned code, RC_WRITE_FAILED if a page could not be
+ *         written; it stays dirty. With a durability level the file
+ *         is synced by syncPageFile afterwards
+ ***************************************************************/
+RC forceFlushPool(BM_BufferPool *const bm){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    pageFrame *current= (pageFrame*)pg->head;
+    pthread_t threads[BM_MAX_FLUSH_THREADS];
+    flushJob job;
+    int n=0,i,started=0;
+    job.pg=pg;
+    job.frames=(pageFrame**)malloc(sizeof(pageFrame*)*pg->nodeCount);
+    job.runStart=(int*)malloc(sizeof(int)*(pg->nodeCount+1));
+    if(job.frames==NULL || job.runStart==NULL){
+        free(job.frames);
+        free(job.runStart);
+        return RC_BUFFER_ALLOC_FAILED;
+    }
+    latch(pg,&pg->evictLatch);
+    latchIO(pg,true);
+    ////Iterate through buffer and find page with fixcount zero and dirty bit=1 and reset it
+    do{
+        //clear first, a thread changing the page during the write marks it again
+        if(__atomic_load_n(&current->fixcount,__ATOMIC_ACQUIRE)==0 && clearDirty(pg,current))
+            job.frames[n++]=current;
+        current=current->next;
+    }while(current!=pg->head);
+    qsort(job.frames,n,sizeof(pageFrame*),comparePages);
+    job.numRuns=0;
+    for(i=0;i<n;i++){
+        if(i==0 || job.frames[i]->pageNo!=job.frames[i-1]->pageNo+1 || i-job.runStart[job.numRuns-1]==BM_FLUSH_RUN)
+            job.runStart[job.numRuns++]=i;
+    }
+    job.runStart[job.numRuns]=n;
+    job.nextRun=0;
+    job.failed=false;
+    //this thread writes as well, a thread which does not start leaves its runs to the others
+    while(started<pg->flushThreads-1 && started<job.numRuns-1 && pthread_create(&threads[started],NULL,flushRuns,&job)==0)
+        started++;
+    flushRuns(&job);
+    for(i=0;i<started;i++)
+        pthread_join(threads[i],NULL);
+    unlatchIO(pg);
+    unlatch(pg,&pg->evictLatch);
+    free(job.frames);
+    free(job.runStart);
+    if(job.failed)
+        return RC_WRITE_FAILED;
+    //pages written earlier by the background writer or by misses are synced as well
+    return syncPageFile(pg->fHandle);
+}
+
+/****************************************************************
+ *Function Name: markDirty
+ *
+ * Description: Marks page as dirty and wakes up the background writer
+ *              when the dirty frames reach its high watermark
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *        BM_PageHandle *const page
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC markDirty(BM_BufferPool *const bm, BM_PageHandle *const page){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    tableShard *shard=shardOf(pg,page->pageNum);
+    pageFrame *current;
+    int dirty=0;
+    //find page with pageNum in page table and set the dirty bit
+    latch(pg,&shard->latch);
+    current= findFrame(pg,page->pageNum);
+    if(current!=NULL && !__atomic_exchange_n(&current->dirtyBit,1,__ATOMIC_ACQ_REL))
+        dirty=__atomic_add_fetch(&pg->numDirty,1,__ATOMIC_RELAXED);
+    unlatch(pg,&shard->latch);
+    if(current==NULL)
+        return RC_NO_FILENAME;
+    //only crossing the watermark wakes the writer, it checks again after each round
+    if(pg->cleanerHigh>0 && dirty==pg->cleanerHigh){
+        pthread_mutex_lock(&pg->cleanerLatch);
+        pthread_cond_signal(&pg->cleanerWake);
+        pthread_mutex_unlock(&pg->cleanerLatch);
+    }
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: unpinPage
+ *
+ * Description: unpin pages in buffer
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *        BM_PageHandle *const page
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC unpinPage(BM_BufferPool *const bm, BM_PageHandle *const page){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    tableShard *shard=shardOf(pg,page->pageNum);
+    pageFrame *current;
+    //find page with pageNum in page table and decrease fixcount
+    latch(pg,&shard->latch);
+    current= findFrame(pg,page->pageNum);
+    unlatch(pg,&shard->latch);
+    if(current!=NULL)
+        unpinFrame(pg,current);
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: forcePage
+ *
+ * Description: write pages back to the pagefile on disk and reset dirty bit.
+ *              The page is pinned during the write so it stays in its frame.
+ *              A page no longer in the buffer was written when it was
+ *              replaced; replacements still writing are waited for. With
+ *              a durability level the file is synced by syncPageFile, so
+ *              forcePage calls of concurrent threads share a group commit
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *        BM_PageHandle *const page
+ *
+ * Return:
+ *     RC: returned code, the error of the write if it failed; the
+ *         page stays dirty then and the file is not synced
+ ***************************************************************/
+RC forcePage(BM_BufferPool *const bm, BM_PageHandle *const page){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    RC rc;
+    //find page with pageNum in page table, write it back and reset dirty bit
+    pageFrame *current= pinResident(pg,page->pageNum);
+    if(current==NULL){
+        //misses write back the pages they replace under the I/O latch
+        latch(pg,&pg->evictLatch);
+        latchIO(pg,true);
+        unlatchIO(pg);
+        unlatch(pg,&pg->evictLatch);
+        return syncPageFile(pg->fHandle);
+    }
+    clearDirty(pg,current);
+    rc=writeFrame(pg,current);
+    if(rc!=RC_OK)
+        restoreDirty(pg,current);
+    unpinFrame(pg,current);
+    if(rc!=RC_OK)
+        return rc;
+    return syncPageFile(pg->fHandle);
+}
+
+/****************************************************************
+ *Function Name: allocatePoolPage
+ *
+ * Description: Allocate page of the page file with allocatePage, a
+ *              freed page if there is one. A copy of the page left in
+ *              the buffer is emptied, so pinning it gives an empty page
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *        PageNumber *pageNum: page allocated
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC allocatePoolPage(BM_BufferPool *const bm, PageNumber *pageNum){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    pageFrame *current;
+    RC rc;
+    //no page is replaced or flushed meanwhile, nor written back by a miss
+    latch(pg,&pg->evictLatch);
+    latchIO(pg,true);
+    rc=allocatePage(pg->fHandle,pageNum);
+    current= rc==RC_OK ? pinResident(pg,*pageNum) : NULL;
+    if(current!=NULL && __atomic_load_n(&current->fixcount,__ATOMIC_ACQUIRE)==1){
+        clearDirty(pg,current);
+        memset(current->data,0,pg->fHandle->pageSize);
+        __atomic_store_n(&current->corrupt,false,__ATOMIC_RELAXED);
+    }
+    unlatchIO(pg);
+    unlatch(pg,&pg->evictLatch);
+    //unpinning may wake waiters, which takes the evict latch
+    if(current!=NULL)
+        unpinFrame(pg,current);
+    return rc;
+}
+
+/****************************************************************
+ *Function Name: freePoolPage
+ *
+ * Description: Free page pageNum of the page file with freePage. Once
+ *              the free is done a copy in the buffer is emptied and its
+ *              changes are dropped, so it is never written over the free
+ *              page record. If freePage fails the copy is left as it is.
+ *              Fails with RC_PINNED_NOT_OUT while the page is pinned
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *        const PageNumber pageNum
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC freePoolPage(BM_BufferPool *const bm, const PageNumber pageNum){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    pageFrame *current;
+    RC rc;
+    //misses write pages back under the I/O latch, flushes under the evict latch, the writer pins them
+    latch(pg,&pg->evictLatch);
+    latchIO(pg,true);
+    current=pinResident(pg,pageNum);
+    if(current!=NULL && __atomic_load_n(&current->fixcount,__ATOMIC_ACQUIRE)>1)
+        rc=RC_PINNED_NOT_OUT;
+    else{
+        rc=freePage(pageNum,pg->fHandle);
+        //a free the file rejected leaves the page in use, with its changes
+        if(rc==RC_OK && current!=NULL){
+            clearDirty(pg,current);
+            memset(current->data,0,pg->fHandle->pageSize);
+            __atomic_store_n(&current->corrupt,false,__ATOMIC_RELAXED);
+        }
+    }
+    unlatchIO(pg);
+    unlatch(pg,&pg->evictLatch);
+    if(current!=NULL)
+        unpinFrame(pg,current);
+    return rc;
+}
+
+/****************************************************************
+ *Function Name: pinFrame / pinResident
+ *
+ * Description: Pin page pageNum if it is in the buffer. Only the latch
+ *              of its page table shard is taken. pinFrame sets busy if
+ *              the frame of the page is claimed: the page is being read,
+ *              or written back before the frame is reused
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *        PageNumber pageNum
+ *        bool *busy
+ *
+ * Return:
+ *     pageFrame*: pinned frame or NULL if page is not in the buffer
+ ***************************************************************/
+static pageFrame *pinFrame(Linkedlist *pg, PageNumber pageNum, bool *busy){
+    tableShard *shard=shardOf(pg,pageNum);
+    pageFrame *current;
+    int count;
+    *busy=false;
+    latch(pg,&shard->latch);
+    current=findFrame(pg,pageNum);
+    if(current!=NULL){
+        count=__atomic_load_n(&current->fixcount,__ATOMIC_RELAXED);
+        do{
+            //frame is being replaced, the page has to be loaded again
+            if(count<0){
+                current=NULL;
+                *busy=true;
+                break;
+            }
+        }while(!__atomic_compare_exchange_n(&current->fixcount,&count,count+1,true,__ATOMIC_SEQ_CST,__ATOMIC_RELAXED));
+    }
+    unlatch(pg,&shard->latch);
+    return current;
+}
+
+pageFrame *pinResident(Linkedlist *pg, PageNumber pageNum){
+    bool busy;
+    return pinFrame(pg,pageNum,&busy);
+}
+
+/****************************************************************
+ *Function Name: unpinFrame
+ *
+ * Description: Decrease fixcount of frame and wake up threads waiting
+ *              for an unpinned frame if it dropped to zero
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *        pageFrame *frame
+ *
+ * Return:
+ *     void
+ ***************************************************************/
+void unpinFrame(Linkedlist *pg, pageFrame *frame){
+    int count=__atomic_load_n(&frame->fixcount,__ATOMIC_RELAXED);
+    do{
+        if(count<=0)
+            return;
+    }while(!__atomic_compare_exchange_n(&frame->fixcount,&count,count-1,true,__ATOMIC_SEQ_CST,__ATOMIC_RELAXED));
+    if(count==1)
+        wakeWaiters(pg);
+}
+
+/****************************************************************
+ *Function Name: wakeWaiters
+ *
+ * Description: Wake up threads waiting for a frame of the pool
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *
+ * Return:
+ *     void
+ ***************************************************************/
+void wakeWaiters(Linkedlist *pg){
+    if(__atomic_load_n(&pg->waiters,__ATOMIC_SEQ_CST)>0){
+        pthread_mutex_lock(&pg->evictLatch);
+        pthread_cond_broadcast(&pg->frameFree);
+        pthread_mutex_unlock(&pg->evictLatch);
+    }
+}
+
+/****************************************************************
+ *Function Name: mustWait
+ *
+ * Description: Returns true if a miss which got rc from loadPage waits
+ *              for a frame: its page is being read or written back by
+ *              another miss, or every frame is pinned and the pool
+ *              blocks or the background writer holds frames
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *        RC rc
+ *
+ * Return:
+ *     bool
+ ***************************************************************/
+static bool mustWait(Linkedlist *pg, RC rc){
+    if(rc==RC_PAGE_BUSY)
+        return true;
+    return rc==RC_NO_UNPINNED_FRAME && (pg->blocking || __atomic_load_n(&pg->cleanerPins,__ATOMIC_SEQ_CST)>0);
+}
+
+/****************************************************************
+ *Function Name: pinPage
+ *
+ * Description: pin page with page number pageNum. A hit only takes the
+ *              latch of its page table shard; a concurrent pool collects
+ *              the hits of strategies which reorder frames per shard
+ *              (deferHit), a single threaded one updates them at once.
+ *              A miss chooses and reserves its frame under the evict
+ *              latch (loadPage), then writes back the old page and reads
+ *              the new one without it, so misses of several threads
+ *              overlap their I/O. Pins of a page being read or written
+ *              back wait for it; in concurrent mode a miss also waits
+ *              until a frame is unpinned instead of returning
+ *              RC_NO_UNPINNED_FRAME. A miss also waits for frames the
+ *              background writer holds. A page that failed checksum
+ *              verification is pinned anyway and RC_CHECKSUM_MISMATCH is
+ *              returned until it is written back. If the dirty page the
+ *              miss replaces cannot be written back it stays in the
+ *              buffer and RC_WRITE_FAILED is returned
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *        BM_PageHandle *const page
+ *        PageNumber pageNum
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page, const  PageNumber pageNum){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    pageFrame *current;
+    bool load=false;
+    bool submitted;
+    RC rc;
+    __atomic_fetch_add(&shardOf(pg,pageNum)->pins,1,__ATOMIC_RELAXED);
+    current=pinResident(pg,pageNum);
+    if(current!=NULL){
+        //FIFO and CLOCK do not reorder frames on a hit
+        if(bm->strategy==RS_FIFO || bm->strategy==RS_CLOCK || !pg->concurrent)
+            hitFrame(bm,current);
+        else
+            deferHit(bm,current,pageNum);
+        page->pageNum= pageNum;
+        page->data=current->data;
+        return __atomic_load_n(&current->corrupt,__ATOMIC_RELAXED) ? RC_CHECKSUM_MISMATCH : RC_OK;
+    }
+    latch(pg,&pg->evictLatch);
+    latch(pg,&pg->replLatch);
+    //quota was lowered by the registry, give frames back before loading pages;
+    //a page which cannot be written back stays, the next pin tries again
+    if(pg->numResident>__atomic_load_n(&pg->quota,__ATOMIC_RELAXED))
+        shrinkPool(bm);
+    rc=loadPage(bm,page,pageNum);
+    if(mustWait(pg,rc)){
+        //announce the wait before searching again so no unpin is missed
+        __atomic_add_fetch(&pg->waiters,1,__ATOMIC_SEQ_CST);
+        while(mustWait(pg,rc=loadPage(bm,page,pageNum))){
+            pthread_mutex_unlock(&pg->replLatch);
+            pthread_cond_wait(&pg->frameFree,&pg->evictLatch);
+            pthread_mutex_lock(&pg->replLatch);
+        }
+        __atomic_sub_fetch(&pg->waiters,1,__ATOMIC_SEQ_CST);
+    }
+    current= rc==RC_OK ? &pg->frames[(page->data-pg->arena)/pg->fHandle->pageSize] : NULL;
+    //the frame is still claimed, it was reserved for the page; a flush waits for the I/O
+    if(current!=NULL && __atomic_load_n(&current->fixcount,__ATOMIC_RELAXED)<0){
+        load=true;
+        latchIO(pg,false);
+    }
+    unlatch(pg,&pg->replLatch);
+    unlatch(pg,&pg->evictLatch);
+    if(load){
+        if(fillFrame(pg,current,pageNum,false,&submitted)!=RC_OK)
+            rc=RC_WRITE_FAILED;
+        //a frame whose old page could not be written back is only released
+        __atomic_store_n(&current->fixcount,rc==RC_OK ? 1 : 0,__ATOMIC_SEQ_CST);
+        unlatchIO(pg);
+        //pins of the page and of the page the frame held wait for it
+        wakeWaiters(pg);
+    }
+    if(rc==RC_OK && __atomic_load_n(&current->corrupt,__ATOMIC_RELAXED))
+        rc=RC_CHECKSUM_MISMATCH;
+    return rc;
+}
+
+/****************************************************************
+ *Function Name: loadPage
+ *
+ * Description: Load page pageNum which was not found in the buffer
+ *              using the replacement strategy of the pool. Another
+ *              thread may have loaded it meanwhile, then it is a hit.
+ *              The hits collected by the shards are applied before a
+ *              victim is chosen
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *        BM_PageHandle *const page
+ *        PageNumber pageNum
+ *
+ * Return:
+ *     RC: returned code, RC_PAGE_BUSY if the page is being read or
+ *         written back by another miss
+ ***************************************************************/
+RC loadPage(BM_BufferPool *const bm, BM_PageHandle *const page, const  PageNumber pageNum){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    pageFrame *current;
+    bool busy;
+    if(pg->concurrent){
+        current=pinFrame(pg,pageNum,&busy);
+        if(current!=NULL){
+            hitFrame(bm,current);
+            page->pageNum= pageNum;
+            page->data=current->data;
+            return RC_OK;
+        }
+        if(busy)
+            return RC_PAGE_BUSY;
+        drainHits(bm);
+    }
+    if(bm->strategy==RS_FIFO)
+        return FIFO( bm, page, pageNum);
+    if(bm->strategy==RS_LRU)
+        return LRU(bm, page,pageNum);
+    if(bm->strategy==RS_CLOCK)
+        return CLOCK(bm, page, pageNum);
+    if(bm->strategy==RS_LRU_K)
+        return LRU_K(bm, page, pageNum);
+    if(bm->strategy==RS_LFU)
+        return LFU(bm, page, pageNum);
+    if(bm->strategy==RS_ARC)
+        return ARC(bm, page, pageNum);
+    if(bm->strategy==RS_2Q)
+        return TWO_Q(bm, page, pageNum);
+    
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: prefetchPages
+ *
+ * Description: Start reading pages pageNums into the buffer without
+ *              pinning them, so later pins are hits. Reads are submitted
+ *              to the asynchronous I/O queue of the pool and overlap
+ *              with each other; the call returns when all of them are
+ *              complete. Pages already in the buffer or behind the end
+ *              of the file are skipped, and prefetching stops early if
+ *              all frames are pinned. pinPage reads a miss with a
+ *              blocking readBlock, so this is the way for one thread to
+ *              overlap reads of pages it will pin next
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *        const PageNumber *pageNums
+ *        int count
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC prefetchPages(BM_BufferPool *const bm, const PageNumber *pageNums, int count){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    BM_PageHandle page;
+    tableShard *shard;
+    pageFrame *current;
+    RC rc=RC_OK;
+    int i;
+    latch(pg,&pg->evictLatch);
+    latch(pg,&pg->replLatch);
+    if(pg->ioQueue==NULL)
+        initIOQueue(&pg->ioQueue,BM_IO_DEPTH);
+    if(pg->numResident>__atomic_load_n(&pg->quota,__ATOMIC_RELAXED))
+        shrinkPool(bm);
+    pg->prefetching=true;
+    for(i=0;i<count && rc==RC_OK;i++){
+        if(pageNums[i]<0 || pageNums[i]>=__atomic_load_n(&pg->fHandle->totalNumPages,__ATOMIC_RELAXED))
+            continue;
+        //pages being read, by this call or by a miss, are in the page table already
+        shard=shardOf(pg,pageNums[i]);
+        latch(pg,&shard->latch);
+        current=findFrame(pg,pageNums[i]);
+        unlatch(pg,&shard->latch);
+        if(current!=NULL)
+            continue;
+        if(pg->readsInFlight==BM_IO_DEPTH)
+            finishReads(pg,1);
+        rc=loadPage(bm,&page,pageNums[i]);
+        //frames of finished reads can be replaced again
+        if(rc==RC_NO_UNPINNED_FRAME && pg->readsInFlight>0){
+            finishReads(pg,1);
+            rc=loadPage(bm,&page,pageNums[i]);
+        }
+    }
+    pg->prefetching=false;
+    while(pg->readsInFlight>0)
+        finishReads(pg,pg->readsInFlight);
+    //waiting misses may use the new frames, the evict latch is held already
+    if(pg->concurrent && __atomic_load_n(&pg->waiters,__ATOMIC_SEQ_CST)>0)
+        pthread_cond_broadcast(&pg->frameFree);
+    unlatch(pg,&pg->replLatch);
+    unlatch(pg,&pg->evictLatch);
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: finishReads
+ *
+ * Description: Wait for at least minWait reads of prefetchPages and
+ *              release their frames unpinned; the pages are in the page
+ *              table since loadFrame
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *        int minWait
+ *
+ * Return:
+ *     int: reads completed
+ ***************************************************************/
+int finishReads(Linkedlist *pg, int minWait){
+    SM_IOCompletion done[BM_IO_DEPTH];
+    pageFrame *frame;
+    int n,i;
+    n=pollCompletions(pg->ioQueue,done,BM_IO_DEPTH,minWait);
+    for(i=0;i<n;i++){
+        frame=(pageFrame*)done[i].userData;
+        if(done[i].rc!=RC_OK && done[i].rc!=RC_CHECKSUM_MISMATCH)
+            memset(frame->data,0,pg->fHandle->pageSize);
+        __atomic_store_n(&frame->corrupt,done[i].rc==RC_CHECKSUM_MISMATCH,__ATOMIC_RELAXED);
+        __atomic_store_n(&frame->fixcount,0,__ATOMIC_RELEASE);
+    }
+    pg->readsInFlight-=n;
+    return n;
+}
+
+/****************************************************************
+ *Function Name: hitFrame
+ *
+ * Description: Update bookkeeping of the replacement strategy for a
+ *              pin of a page which is already in frame current. In
+ *              concurrent mode the caller holds the replacement latch,
+ *              except for FIFO and CLOCK; pinPage collects the hits of
+ *              the other strategies with deferHit
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *        pageFrame *current
+ *
+ * Return:
+ *     void
+ ***************************************************************/
+void hitFrame(BM_BufferPool *const bm, pageFrame *current){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    freqBucket *bucket,*after;
+    long now,correlated;
+    int i;
+    if(bm->strategy==RS_CLOCK)
+        __atomic_store_n(&current->refBit,1,__ATOMIC_RELAXED);
+    else if(bm->strategy==RS_LRU){
+        listRemove(&pg->lruList,current);
+        listPushFront(&pg->lruList,current);
+    }
+    else if(bm->strategy==RS_LRU_K){
+        now=++pg->timeStamp;
+        if(now-current->last>pg->correlatedPeriod){
+            //close correlated period and shift reference history
+            correlated=current->last-current->hist[0];
+            for(i=pg->k-1;i>0;i--)
+                current->hist[i]=current->hist[i-1]==0 ? 0 : current->hist[i-1]+correlated;
+            current->hist[0]=now;
+        }
+        current->last=now;
+        //references only make a page older in heap order
+        heapSiftDown(pg,current->heapPos);
+    }
+    else if(bm->strategy==RS_LFU){
+        if(pg->agingPeriod>0 && ++pg->timeStamp%pg->agingPeriod==0)
+            lfuAge(pg);
+        //move frame to bucket freq+1, which is next to its own bucket
+        bucket=current->bucket;
+        after= bucket->frames.size>1 ? bucket : bucket->prev;
+        lfuRemove(pg,current);
+        lfuInsert(pg,current,after,current->freq+1);
+    }
+    else if(bm->strategy==RS_ARC){
+        listRemove(current->owner,current);
+        listPushFront(&pg->frequent,current);
+    }
+    //hits in A1in of 2Q do not change its FIFO order
+    else if(bm->strategy==RS_2Q && current->owner==&pg->frequent){
+        listRemove(&pg->frequent,current);
+        listPushFront(&pg->frequent,current);
+    }
+}
+
+/****************************************************************
+ *Function Name: takeHits / applyHits
+ *
+ * Description: Move the hits collected by shard into frames and pages
+ *              and empty it, the caller holds the latch of the shard /
+ *              call hitFrame for n collected hits, the caller holds the
+ *              replacement latch. A hit whose frame was replaced since,
+ *              or is being replaced, is dropped
+ *
+ * Parameter:
+ *        tableShard *shard / BM_BufferPool *const bm
+ *        int *frames
+ *        PageNumber *pages
+ *        int n
+ *
+ * Return:
+ *     int: hits taken / void
+ ***************************************************************/
+static int takeHits(tableShard *shard, int *frames, PageNumber *pages){
+    int n=shard->numHits;
+    memcpy(frames,shard->hitFrames,sizeof(int)*n);
+    memcpy(pages,shard->hitPages,sizeof(PageNumber)*n);
+    shard->numHits=0;
+    return n;
+}
+
+static void applyHits(BM_BufferPool *const bm, int *frames, PageNumber *pages, int n){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    pageFrame *current;
+    int i;
+    for(i=0;i<n;i++){
+        current=&pg->frames[frames[i]];
+        //frames are only claimed under the replacement latch
+        if(__atomic_load_n(&current->pageNo,__ATOMIC_RELAXED)==pages[i] && __atomic_load_n(&current->fixcount,__ATOMIC_RELAXED)>=0)
+            hitFrame(bm,current);
+    }
+}
+
+/****************************************************************
+ *Function Name: deferHit / drainHits
+ *
+ * Description: A hit of a concurrent pool is recorded in the shard of
+ *              its page instead of taking the replacement latch; once
+ *              BM_HIT_BATCH hits are collected they are applied in one
+ *              go. drainHits applies the hits of every shard, misses
+ *              call it before they choose a victim. The caller of
+ *              drainHits holds the replacement latch
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *        pageFrame *current: frame pinned by the hit
+ *        PageNumber pageNum
+ *
+ * Return:
+ *     void
+ ***************************************************************/
+void deferHit(BM_BufferPool *const bm, pageFrame *current, PageNumber pageNum){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    tableShard *shard=shardOf(pg,pageNum);
+    int frames[BM_HIT_BATCH];
+    PageNumber pages[BM_HIT_BATCH];
+    int n=0;
+    pthread_mutex_lock(&shard->latch);
+    shard->hitFrames[shard->numHits]=current-pg->frames;
+    shard->hitPages[shard->numHits++]=pageNum;
+    if(shard->numHits==BM_HIT_BATCH)
+        n=takeHits(shard,frames,pages);
+    pthread_mutex_unlock(&shard->latch);
+    //shard latches are taken after the replacement latch, never before
+    if(n>0){
+        pthread_mutex_lock(&pg->replLatch);
+        applyHits(bm,frames,pages,n);
+        pthread_mutex_unlock(&pg->replLatch);
+    }
+}
+
+void drainHits(BM_BufferPool *const bm){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    int frames[BM_HIT_BATCH];
+    PageNumber pages[BM_HIT_BATCH];
+    int i,n;
+    if(bm->strategy==RS_FIFO || bm->strategy==RS_CLOCK)
+        return;
+    for(i=0;i<pg->numShards;i++){
+        latch(pg,&pg->shards[i].latch);
+        n=takeHits(&pg->shards[i],frames,pages);
+        unlatch(pg,&pg->shards[i].latch);
+        applyHits(bm,frames,pages,n);
+    }
+}
+
+/****************************************************************
+ *Function Name: getFrameContents
+ *
+ * Description: returns an array of page number in buffer
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *
+ * Return:
+ *     PageNumber
+ ***************************************************************/
+PageNumber *getFrameContents (BM_BufferPool *const bm)
+{
+    PageNumber *frameContents = (PageNumber*)malloc(sizeof(PageNumber) * bm->numPages);
+    int i=0;
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    pageFrame *current= (pageFrame*)pg->head;
+    //Iterate through buffer
+    do{
+        frameContents[i]=__atomic_load_n(&current->pageNo,__ATOMIC_RELAXED);
+        i++;
+        
+        current =current->next;
+    }while(current!=pg->head);
+    return frameContents;
+    
+    
+}
+
+/****************************************************************
+ *Function Name: getDirtyFlags
+ *
+ * Description: returns an array of dirty bit in pageFrame
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *
+ *
+ * Return:
+ *     bool
+ ***************************************************************/
+bool *getDirtyFlags (BM_BufferPool *const bm)
+{
+    bool *dirtyFlags = (bool*)malloc(sizeof(bool) * bm->numPages);
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    pageFrame *current= (pageFrame*)pg->head;
+    
+    int i=0;
+    //Iterate through buffer
+    do{
+        dirtyFlags[i]=__atomic_load_n(&current->dirtyBit,__ATOMIC_RELAXED);
+        i++;
+        
+        current=current->next;
+    }while(current!=pg->head);
+    return dirtyFlags;
+}
+
+/****************************************************************
+ *Function Name: getFixCounts
+ *
+ * Description: returns an array of fix count of pages in PageFrame
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *
+ * Return:
+ *     int
+ ***************************************************************/
+int *getFixCounts (BM_BufferPool *const bm)
+{
+    int *fixCounts = (int*)malloc(sizeof(int) * bm->numPages);
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    pageFrame *current= (pageFrame*)pg->head;
+    int i = 0;
+    //Iterate through buffer
+    do{
+        fixCounts[i]=__atomic_load_n(&current->fixcount,__ATOMIC_RELAXED);
+        i++;
+        
+        current=current->next;
+    }while(current!=pg->head);
+    return fixCounts;
+    
+    
+}
+
+/****************************************************************
+ *Function Name: getNunReadIO
+ *
+ * Description: Returns number of pages read from disk
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *
+ * Return:
+ *     int
+ ***************************************************************/
+int getNumReadIO (BM_BufferPool *const bm)
+{
+    return __atomic_load_n(&((Linkedlist*)bm->mgmtData)->numReadIO,__ATOMIC_RELAXED);
+}
+
+/****************************************************************
+ *Function Name: getWriteIO
+ *
+ * Description: Returns number of written back to page file
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *
+ * Return:
+ *     int
+ ***************************************************************/
+int getNumWriteIO (BM_BufferPool *const bm)
+{
+    return __atomic_load_n(&((Linkedlist*)bm->mgmtData)->numWriteIO,__ATOMIC_RELAXED);
+}
+
+/****************************************************************
+ *Function Name: getPoolPageSize
+ *
+ * Description: Returns page size of the page file of the pool, the
+ *              size of the data of every page handle it pins. With
+ *              checksums the trailer is not part of the data
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *
+ * Return:
+ *     int
+ ***************************************************************/
+int getPoolPageSize (BM_BufferPool *const bm)
+{
+    Linkedlist *lst=(Linkedlist*)bm->mgmtData;
+    return lst->checksums ? lst->fHandle->pageSize-SM_CHECKSUM_SIZE : lst->fHandle->pageSize;
+}
+
+/****************************************************************
+ *Function Name: writeFrame
+ *
+ * Description: Write page held in frame back to the page file. A page
+ *              which failed checksum verification is valid once written.
+ *              Only successful writes are counted
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *        pageFrame *frame
+ *
+ * Return:
+ *     RC: returned code of writeBlock
+ ***************************************************************/
+RC writeFrame(Linkedlist *pg, pageFrame *frame){
+    //positional writes, threads do not serialise on the file handle
+    RC rc=writeBlock(frame->pageNo,pg->fHandle,frame->data);
+    if(rc!=RC_OK)
+        return rc;
+    __atomic_store_n(&frame->corrupt,0,__ATOMIC_RELAXED);
+    __atomic_fetch_add(&pg->numWriteIO,1,__ATOMIC_RELAXED);
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: addDirty / listDirty
+ *
+ * Description: Append page held in frame, or held in the frames of lst
+ *              from the least recently used end, to the batch of the
+ *              background writer if it is dirty and unpinned
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *        pageFrame *frame / frameList *lst
+ *        int n: pages already in the batch
+ *        int max
+ *
+ * Return:
+ *    int: pages in the batch
+ ***************************************************************/
+static int addDirty(Linkedlist *pg, pageFrame *frame, int n, int max){
+    PageNumber pageNum;
+    if(n>=max || __atomic_load_n(&frame->fixcount,__ATOMIC_RELAXED)!=0 || !__atomic_load_n(&frame->dirtyBit,__ATOMIC_RELAXED))
+        return n;
+    pageNum=__atomic_load_n(&frame->pageNo,__ATOMIC_RELAXED);
+    if(pageNum!=NO_PAGE)
+        pg->cleanBatch[n++]=pageNum;
+    return n;
+}
+
+static int listDirty(Linkedlist *pg, frameList *lst, int n, int max){
+    pageFrame *current;
+    for(current=lst->last;current!=NULL && n<max;current=current->lruPrev)
+        n=addDirty(pg,current,n,max);
+    return n;
+}
+
+/****************************************************************
+ *Function Name: collectDirty
+ *
+ * Description: Fill batch of the background writer with up to max
+ *              dirty, unpinned pages in the order the replacement
+ *              strategy would evict them, so the frames the next misses
+ *              replace are clean. The caller holds the replacement latch
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *        int max
+ *
+ * Return:
+ *    int: pages in the batch
+ ***************************************************************/
+int collectDirty(BM_BufferPool *const bm, int max){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    pageFrame *current;
+    freqBucket *bucket;
+    int n=0,i;
+    if(bm->strategy==RS_LRU)
+        n=listDirty(pg,&pg->lruList,n,max);
+    //heap array is roughly in eviction order
+    else if(bm->strategy==RS_LRU_K){
+        for(i=0;i<pg->heapSize && n<max;i++)
+            n=addDirty(pg,pg->heap[i],n,max);
+    }
+    else if(bm->strategy==RS_LFU){
+        for(bucket=pg->minBucket;bucket!=NULL && n<max;bucket=bucket->next)
+            n=listDirty(pg,&bucket->frames,n,max);
+    }
+    else if(bm->strategy==RS_ARC || bm->strategy==RS_2Q){
+        n=listDirty(pg,&pg->recent,n,max);
+        n=listDirty(pg,&pg->frequent,n,max);
+    }
+    //FIFO and CLOCK replace frames in ring order
+    else{
+        current= bm->strategy==RS_CLOCK ? pg->clockHand : pg->curPos->next;
+        for(i=0;i<pg->nodeCount && n<max;i++){
+            n=addDirty(pg,current,n,max);
+            current=current->next;
+        }
+    }
+    return n;
+}
+
+/****************************************************************
+ *Function Name: cleanPages
+ *
+ * Description: Write back dirty, unpinned pages until the dirty frames
+ *              of the pool drop to the low watermark. A page is pinned
+ *              while it is written, so it cannot be replaced meanwhile;
+ *              pages pinned by other threads are skipped. Up to
+ *              BM_IO_DEPTH writes are in flight at once
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *
+ * Return:
+ *    int: pages written
+ ***************************************************************/
+int cleanPages(BM_BufferPool *const bm){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    pageFrame *current;
+    tableShard *shard;
+    int n,i,count,written=0,pending=0;
+    n=__atomic_load_n(&pg->numDirty,__ATOMIC_RELAXED)-pg->cleanerLow;
+    if(n<=0)
+        return 0;
+    latch(pg,&pg->replLatch);
+    n=collectDirty(bm,n);
+    unlatch(pg,&pg->replLatch);
+    for(i=0;i<n;i++){
+        //a miss finding every frame pinned waits while the writer holds frames
+        __atomic_add_fetch(&pg->cleanerPins,1,__ATOMIC_SEQ_CST);
+        shard=shardOf(pg,pg->cleanBatch[i]);
+        latch(pg,&shard->latch);
+        current=findFrame(pg,pg->cleanBatch[i]);
+        count=0;
+        if(current!=NULL && !__atomic_compare_exchange_n(&current->fixcount,&count,1,false,__ATOMIC_SEQ_CST,__ATOMIC_RELAXED))
+            current=NULL;
+        unlatch(pg,&shard->latch);
+        //frame stays pinned until its write completes
+        if(current!=NULL && clearDirty(pg,current)){
+            if(pending==BM_IO_DEPTH)
+                pending-=finishWrites(pg,1);
+            if(submitWrite(pg->cleanQueue,current->pageNo,pg->fHandle,current->data,current)==RC_OK){
+                pending++;
+                written++;
+                continue;
+            }
+            if(writeFrame(pg,current)==RC_OK)
+                written++;
+            else
+                restoreDirty(pg,current);
+        }
+        if(current!=NULL)
+            unpinFrame(pg,current);
+        __atomic_sub_fetch(&pg->cleanerPins,1,__ATOMIC_SEQ_CST);
+    }
+    while(pending>0)
+        pending-=finishWrites(pg,pending);
+    return written;
+}
+
+/****************************************************************
+ *Function Name: finishWrites
+ *
+ * Description: Wait for at least minWait writes of the background
+ *              writer and unpin their frames. A page whose write failed
+ *              is marked dirty again
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *        int minWait
+ *
+ * Return:
+ *    int: writes completed
+ ***************************************************************/
+int finishWrites(Linkedlist *pg, int minWait){
+    SM_IOCompletion done[BM_IO_DEPTH];
+    pageFrame *frame;
+    int n,i;
+    n=pollCompletions(pg->cleanQueue,done,BM_IO_DEPTH,minWait);
+    for(i=0;i<n;i++){
+        frame=(pageFrame*)done[i].userData;
+        if(done[i].rc!=RC_OK)
+            restoreDirty(pg,frame);
+        else{
+            __atomic_store_n(&frame->corrupt,0,__ATOMIC_RELAXED);
+            __atomic_fetch_add(&pg->numWriteIO,1,__ATOMIC_RELAXED);
+        }
+        unpinFrame(pg,frame);
+        __atomic_sub_fetch(&pg->cleanerPins,1,__ATOMIC_SEQ_CST);
+    }
+    return n;
+}
+
+/****************************************************************
+ *Function Name: cleanerMain
+ *
+ * Description: Background writer of a pool. Sleeps until the dirty
+ *              frames reach the high watermark, then cleans down to the
+ *              low watermark. If all dirty pages are pinned it tries
+ *              again after CLEANER_PERIOD_MS
+ *
+ * Parameter:
+ *        void *arg: BM_BufferPool
+ *
+ * Return:
+ *    void*
+ ***************************************************************/
+static void *cleanerMain(void *arg){
+    BM_BufferPool *bm=(BM_BufferPool*)arg;
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    struct timespec until;
+    int written;
+    pthread_mutex_lock(&pg->cleanerLatch);
+    while(!pg->cleanerStop){
+        if(__atomic_load_n(&pg->numDirty,__ATOMIC_RELAXED)>=pg->cleanerHigh){
+            pthread_mutex_unlock(&pg->cleanerLatch);
+            written=cleanPages(bm);
+            pthread_mutex_lock(&pg->cleanerLatch);
+            if(written>0)
+                continue;
+        }
+        clock_gettime(CLOCK_REALTIME,&until);
+        until.tv_nsec+=CLEANER_PERIOD_MS*1000000L;
+        if(until.tv_nsec>=1000000000L){
+            until.tv_sec++;
+            until.tv_nsec-=1000000000L;
+        }
+        pthread_cond_timedwait(&pg->cleanerWake,&pg->cleanerLatch,&until);
+    }
+    pthread_mutex_unlock(&pg->cleanerLatch);
+    return NULL;
+}
+
+/****************************************************************
+ *Function Name: startCleaner / stopCleaner
+ *
+ * Description: Start and stop the background writer of the pool. If
+ *              the thread cannot be started the pool runs without it
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm / Linkedlist *pg
+ *
+ * Return:
+ *    void
+ ***************************************************************/
+void startCleaner(BM_BufferPool *const bm){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    pg->cleanerStop=false;
+    if(pthread_create(&pg->cleaner,NULL,cleanerMain,bm)!=0)
+        pg->cleanerHigh=0;
+}
+
+void stopCleaner(Linkedlist *pg){
+    pthread_mutex_lock(&pg->cleanerLatch);
+    pg->cleanerStop=true;
+    pthread_cond_signal(&pg->cleanerWake);
+    pthread_mutex_unlock(&pg->cleanerLatch);
+    pthread_join(pg->cleaner,NULL);
+}
+
+/****************************************************************
+ *Function Name: loadFrame
+ *
+ * Description: Reserve claimed frame current for page pageNum. The
+ *              page goes into the page table while the frame is still
+ *              claimed, so pins of it wait until it is read; the old
+ *              page of the frame stays in the table until fillFrame has
+ *              written it back, so pins of it wait as well. pinPage
+ *              calls fillFrame once it released the evict latch. During
+ *              prefetchPages fillFrame is called here and only submits
+ *              the read, the frame stays claimed until finishReads. If
+ *              the write-back fails the frame is released with its old
+ *              page and the page is not prefetched
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *        pageFrame *current
+ *        BM_PageHandle *const page
+ *        PageNumber pageNum
+ *
+ * Return:
+ *     void
+ ***************************************************************/
+void loadFrame(BM_BufferPool *const bm, pageFrame *current, BM_PageHandle *const page, const PageNumber pageNum){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    tableShard *shard=shardOf(pg,pageNum);
+    bool submitted;
+    latch(pg,&shard->latch);
+    insertPage(&shard->table,pageNum,current-pg->frames);
+    unlatch(pg,&shard->latch);
+    __atomic_fetch_add(&pg->numReadIO,1,__ATOMIC_RELAXED);
+    __atomic_fetch_add(&pg->windowReads,1,__ATOMIC_RELAXED);
+    page->pageNum= pageNum;
+    page->data=current->data;
+    if(!pg->prefetching)
+        return;
+    //the frame is in no strategy list yet, the replacement latch is not needed during the I/O
+    unlatch(pg,&pg->replLatch);
+    if(fillFrame(pg,current,pageNum,true,&submitted)==RC_OK && submitted)
+        pg->readsInFlight++;
+    else
+        __atomic_store_n(&current->fixcount,0,__ATOMIC_RELEASE);
+    latch(pg,&pg->replLatch);
+}
+
+/****************************************************************
+ *Function Name: fillFrame
+ *
+ * Description: Write back the page held in claimed frame current if
+ *              it is dirty, remove it from the page table and read page
+ *              pageNum from disk into the frame. With submit the read is
+ *              submitted to the I/O queue of the pool if possible. The
+ *              caller holds neither the evict nor the replacement latch,
+ *              except during prefetchPages, and publishes the frame
+ *              afterwards. If the write-back fails the frame keeps the
+ *              old page, still dirty, and page pageNum is removed from
+ *              the page table again; the caller releases the frame
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *        pageFrame *current
+ *        PageNumber pageNum
+ *        bool submit
+ *        bool *submitted: set if the read was submitted, finishReads
+ *                         completes it
+ *
+ * Return:
+ *     RC: returned code, RC_WRITE_FAILED if the old page could not be
+ *         written back
+ ***************************************************************/
+RC fillFrame(Linkedlist *pg, pageFrame *current, PageNumber pageNum, bool submit, bool *submitted){
+    PageNumber old=current->pageNo;
+    tableShard *shard;
+    RC rc;
+    *submitted=false;
+    if(old!=NO_PAGE){
+        if(clearDirty(pg,current) && writeFrame(pg,current)!=RC_OK){
+            //the old page stays in the frame with its changes, the miss fails
+            restoreDirty(pg,current);
+            shard=shardOf(pg,pageNum);
+            latch(pg,&shard->latch);
+            removePage(&shard->table,pageNum);
+            unlatch(pg,&shard->latch);
+            __atomic_fetch_sub(&pg->numReadIO,1,__ATOMIC_RELAXED);
+            //the victim search remembered the old page as replaced
+            latch(pg,&pg->replLatch);
+            forgetGhost(pg,old);
+            unlatch(pg,&pg->replLatch);
+            return RC_WRITE_FAILED;
+        }
+        //written back, a miss on the old page reads it from disk again
+        shard=shardOf(pg,old);
+        latch(pg,&shard->latch);
+        removePage(&shard->table,old);
+        unlatch(pg,&shard->latch);
+    }
+    __atomic_store_n(&current->pageNo,pageNum,__ATOMIC_RELAXED);
+    if(submit && submitRead(pg->ioQueue,pageNum,pg->fHandle,current->data,current)==RC_OK){
+        *submitted=true;
+        return RC_OK;
+    }
+    rc=readBlock(pageNum,pg->fHandle,current->data);
+    //page does not exist on disk yet, start with an empty page
+    if(rc!=RC_OK && rc!=RC_CHECKSUM_MISMATCH)
+        memset(current->data,0,pg->fHandle->pageSize);
+    //a corrupt page is kept as read, pinPage reports it
+    __atomic_store_n(&current->corrupt,rc==RC_CHECKSUM_MISMATCH,__ATOMIC_RELAXED);
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: fifoVictim
+ *
+ * Description: Claims the oldest unpinned page after the last loaded
+ *              frame and returns it, NULL if all pages are pinned
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *
+ * Return:
+ *     pageFrame*
+ ***************************************************************/
+pageFrame *fifoVictim(Linkedlist *pg){
+    pageFrame *current=pg->curPos->next;
+    do{
+        //misses set the page of a reused frame without the evict latch
+        if(__atomic_load_n(&current->pageNo,__ATOMIC_RELAXED)!=NO_PAGE && claimFrame(current)){
+            pg->curPos=current;
+            return current;
+        }
+        current=current->next;
+    }while(current!=pg->curPos->next);
+    return NULL;
+}
+
+/****************************************************************
+ *Function Name: FIFO
+ *
+ * Description: Implements first in first out strategy, loads page
+ *              pageNum which is not in the buffer
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *        BM_PageHandle *const page
+ *        PageNumber pageNum
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC FIFO(BM_BufferPool *const bm, BM_PageHandle *const page, const  PageNumber pageNum){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    pageFrame *current;
+    //fill empty frames first, when the buffer is full replace the oldest page
+    current=getFreeFrame(pg);
+    if(current==NULL)
+        current=fifoVictim(pg);
+    if(current==NULL)
+        return RC_NO_UNPINNED_FRAME;
+    loadFrame(bm,current,page,pageNum);
+    pg->curPos=current;
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: clockVictim
+ *
+ * Description: Move the clock hand until it finds an unpinned page
+ *              whose reference bit is clear, clearing the bits it
+ *              passes. Returns NULL if all pages are pinned
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *
+ * Return:
+ *     pageFrame*
+ ***************************************************************/
+pageFrame *clockVictim(Linkedlist *pg){
+    pageFrame *current=pg->clockHand;
+    int i;
+    //two sweeps clear every reference bit, so an unpinned frame is found if one exists
+    for(i=0;i<2*pg->nodeCount;i++){
+        //hits set reference bits without the replacement latch
+        if(__atomic_load_n(&current->fixcount,__ATOMIC_RELAXED)==0 && __atomic_load_n(&current->pageNo,__ATOMIC_RELAXED)!=NO_PAGE){
+            if(!__atomic_load_n(&current->refBit,__ATOMIC_RELAXED) && claimFrame(current)){
+                pg->clockHand=current->next;
+                return current;
+            }
+            __atomic_store_n(&current->refBit,0,__ATOMIC_RELAXED);
+        }
+        current=current->next;
+    }
+    return NULL;
+}
+
+/****************************************************************
+ *Function Name: CLOCK
+ *
+ * Description: Implements clock (second chance) strategy for a page
+ *              which is not in the buffer. A hit only sets the reference
+ *              bit of the frame (hitFrame). On replacement the hand
+ *              clears reference bits until it finds an unpinned frame
+ *              whose bit is already clear
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *        BM_PageHandle *const page
+ *        PageNumber pageNum
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC CLOCK(BM_BufferPool *const bm, BM_PageHandle *const page, const  PageNumber pageNum){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    pageFrame *current;
+    //fill empty frames first
+    current=getFreeFrame(pg);
+    if(current==NULL)
+        current=clockVictim(pg);
+    if(current==NULL)
+        return RC_NO_UNPINNED_FRAME;
+    loadFrame(bm,current,page,pageNum);
+    __atomic_store_n(&current->refBit,1,__ATOMIC_RELAXED);
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: lruVictim
+ *
+ * Description: Remove least recently used unpinned page from the
+ *              recency list and return its frame, NULL if all pinned
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *
+ * Return:
+ *     pageFrame*
+ ***************************************************************/
+pageFrame *lruVictim(Linkedlist *pg){
+    pageFrame *current=listVictim(&pg->lruList);
+    if(current!=NULL)
+        listRemove(&pg->lruList,current);
+    return current;
+}
+
+/****************************************************************
+ *Function Name: LRU
+ *
+ * Description: Replace page which has not been accessed recently.
+ *              A hit moves the frame to the front of the recency list
+ *              (hitFrame), the victim is the unpinned frame closest to
+ *              its end
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *        BM_PageHandle *const page
+ *        PageNumber pageNum
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC LRU(BM_BufferPool *const bm, BM_PageHandle *const page, const  PageNumber pageNum){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    pageFrame *current;
+    //fill empty frames first, when the buffer is full replace least recently used page
+    current=getFreeFrame(pg);
+    if(current==NULL)
+        current=lruVictim(pg);
+    if(current==NULL)
+        return RC_NO_UNPINNED_FRAME;
+    loadFrame(bm,current,page,pageNum);
+    listPushFront(&pg->lruList,current);
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: heapBefore
+ *
+ * Description: Returns true if frame a should be replaced before
+ *              frame b, i.e. its K-th most recent reference is older.
+ *              Pages with less than K references have no K-th
+ *              reference (0) and are replaced first, in LRU order
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *        pageFrame *a
+ *        pageFrame *b
+ *
+ * Return:
+ *     bool
+ ***************************************************************/
+static bool heapBefore(Linkedlist *pg, pageFrame *a, pageFrame *b){
+    if(a->hist[pg->k-1]!=b->hist[pg->k-1])
+        return a->hist[pg->k-1]<b->hist[pg->k-1];
+    return a->last<b->last;
+}
+
+/****************************************************************
+ *Function Name: heapSet
+ *
+ * Description: Place frame at position pos of the heap
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *        int pos
+ *        pageFrame *frame
+ *
+ * Return:
+ *     void
+ ***************************************************************/
+static void heapSet(Linkedlist *pg, int pos, pageFrame *frame){
+    pg->heap[pos]=frame;
+    frame->heapPos=pos;
+}
+
+/****************************************************************
+ *Function Name: heapSiftDown
+ *
+ * Description: Restore heap order below position pos
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *        int pos
+ *
+ * Return:
+ *     void
+ ***************************************************************/
+void heapSiftDown(Linkedlist *pg, int pos){
+    pageFrame *frame=pg->heap[pos];
+    int child;
+    while((child=2*pos+1)<pg->heapSize){
+        if(child+1<pg->heapSize && heapBefore(pg,pg->heap[child+1],pg->heap[child]))
+            child++;
+        if(!heapBefore(pg,pg->heap[child],frame))
+            break;
+        heapSet(pg,pos,pg->heap[child]);
+        pos=child;
+    }
+    heapSet(pg,pos,frame);
+}
+
+/****************************************************************
+ *Function Name: heapPush
+ *
+ * Description: Add frame to the heap of replacement candidates
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *        pageFrame *frame
+ *
+ * Return:
+ *     void
+ ***************************************************************/
+void heapPush(Linkedlist *pg, pageFrame *frame){
+    int pos=pg->heapSize++;
+    int parent;
+    while(pos>0){
+        parent=(pos-1)/2;
+        if(!heapBefore(pg,frame,pg->heap[parent]))
+            break;
+        heapSet(pg,pos,pg->heap[parent]);
+        pos=parent;
+    }
+    heapSet(pg,pos,frame);
+}
+
+/****************************************************************
+ *Function Name: heapPop
+ *
+ * Description: Remove and return frame which should be replaced first
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *
+ * Return:
+ *     pageFrame*
+ ***************************************************************/
+pageFrame *heapPop(Linkedlist *pg){
+    pageFrame *top=pg->heap[0];
+    pg->heapSize--;
+    if(pg->heapSize>0){
+        heapSet(pg,0,pg->heap[pg->heapSize]);
+        heapSiftDown(pg,0);
+    }
+    top->heapPos=-1;
+    return top;
+}
+
+/****************************************************************
+ *Function Name: lrukVictim
+ *
+ * Description: Claim the unpinned page with the oldest K-th reference
+ *              whose correlated period is over from the heap and return
+ *              its frame. If every unpinned page is still in its
+ *              correlated period any unpinned page is taken
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *
+ * Return:
+ *     pageFrame*: frame or NULL if all pages are pinned
+ ***************************************************************/
+pageFrame *lrukVictim(Linkedlist *pg){
+    pageFrame **skipped=pg->skipped;
+    pageFrame *current=NULL;
+    int numSkipped=0,i;
+    while(pg->heapSize>0){
+        current=heapPop(pg);
+        if(pg->timeStamp-current->last>pg->correlatedPeriod && claimFrame(current))
+            break;
+        skipped[numSkipped++]=current;
+        current=NULL;
+    }
+    //no page is out of its correlated period, fall back to any unpinned page
+    for(i=0;current==NULL && i<numSkipped;i++){
+        if(claimFrame(skipped[i])){
+            current=skipped[i];
+            skipped[i]=skipped[--numSkipped];
+        }
+    }
+    for(i=0;i<numSkipped;i++)
+        heapPush(pg,skipped[i]);
+    return current;
+}
+
+/****************************************************************
+ *Function Name: LRU_K
+ *
+ * Description: Implements LRU-K strategy. Every frame remembers the
+ *              times of the last K uncorrelated references to its page;
+ *              references closer than correlatedPeriod to the previous
+ *              one only update the last reference time (hitFrame). On a
+ *              miss the victim is
+ *              the unpinned page with the oldest K-th reference, taken
+ *              from a heap ordered by that time
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *        BM_PageHandle *const page
+ *        PageNumber pageNum
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC LRU_K(BM_BufferPool *const bm, BM_PageHandle *const page, const  PageNumber pageNum){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    long now=++pg->timeStamp;
+    pageFrame *current;
+    //fill empty frames first
+    current=getFreeFrame(pg);
+    if(current==NULL)
+        current=lrukVictim(pg);
+    if(current==NULL)
+        return RC_NO_UNPINNED_FRAME;
+    loadFrame(bm,current,page,pageNum);
+    memset(current->hist,0,sizeof(long)*pg->k);
+    current->hist[0]=now;
+    current->last=now;
+    heapPush(pg,current);
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: lfuInsert
+ *
+ * Description: Add frame with reference count freq to the front of
+ *              its bucket. The bucket is the one after bucket after
+ *              (the first bucket if after is NULL) and is created
+ *              there if it does not exist yet
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *        pageFrame *frame
+ *        freqBucket *after
+ *        int freq
+ *
+ * Return:
+ *     void
+ ***************************************************************/
+void lfuInsert(Linkedlist *pg, pageFrame *frame, freqBucket *after, int freq){
+    freqBucket *bucket= after==NULL ? pg->minBucket : after->next;
+    if(bucket==NULL || bucket->freq!=freq){
+        //take new bucket from free list and link it after bucket after
+        bucket=pg->freeBuckets;
+        pg->freeBuckets=bucket->next;
+        bucket->freq=freq;
+        bucket->frames.first=NULL;
+        bucket->frames.last=NULL;
+        bucket->frames.size=0;
+        bucket->prev=after;
+        bucket->next= after==NULL ? pg->minBucket : after->next;
+        if(bucket->next!=NULL)
+            bucket->next->prev=bucket;
+        if(after==NULL)
+            pg->minBucket=bucket;
+        else
+            after->next=bucket;
+    }
+    frame->freq=freq;
+    frame->bucket=bucket;
+    listPushFront(&bucket->frames,frame);
+}
+
+/****************************************************************
+ *Function Name: lfuRemove
+ *
+ * Description: Remove frame from its bucket and free the bucket if
+ *              it became empty
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *        pageFrame *frame
+ *
+ * Return:
+ *     void
+ ***************************************************************/
+void lfuRemove(Linkedlist *pg, pageFrame *frame){
+    freqBucket *bucket=frame->bucket;
+    listRemove(&bucket->frames,frame);
+    frame->bucket=NULL;
+    if(bucket->frames.size>0)
+        return;
+    if(bucket->prev!=NULL)
+        bucket->prev->next=bucket->next;
+    else
+        pg->minBucket=bucket->next;
+    if(bucket->next!=NULL)
+        bucket->next->prev=bucket->prev;
+    bucket->next=pg->freeBuckets;
+    pg->freeBuckets=bucket;
+}
+
+/****************************************************************
+ *Function Name: lfuAge
+ *
+ * Description: Halve reference count of every page so pages which
+ *              were used often long ago can be replaced. Buckets whose
+ *              counts become equal are merged, frames of the bucket
+ *              with the higher old count go to the front
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *
+ * Return:
+ *     void
+ ***************************************************************/
+void lfuAge(Linkedlist *pg){
+    freqBucket *bucket=pg->minBucket;
+    freqBucket *prev=NULL;
+    freqBucket *next;
+    pageFrame *frame;
+    while(bucket!=NULL){
+        next=bucket->next;
+        bucket->freq= bucket->freq>1 ? bucket->freq/2 : 1;
+        if(prev!=NULL && prev->freq==bucket->freq){
+            //splice frames in front of previous bucket and free this one
+            bucket->frames.last->lruNext=prev->frames.first;
+            prev->frames.first->lruPrev=bucket->frames.last;
+            prev->frames.first=bucket->frames.first;
+            prev->frames.size+=bucket->frames.size;
+            prev->next=next;
+            if(next!=NULL)
+                next->prev=prev;
+            bucket->next=pg->freeBuckets;
+            pg->freeBuckets=bucket;
+        }
+        else
+            prev=bucket;
+        bucket=next;
+    }
+    //refresh frame counts and bucket pointers
+    for(bucket=pg->minBucket;bucket!=NULL;bucket=bucket->next){
+        for(frame=bucket->frames.first;frame!=NULL;frame=frame->lruNext){
+            frame->freq=bucket->freq;
+            frame->bucket=bucket;
+            frame->owner=&bucket->frames;
+        }
+    }
+}
+
+/****************************************************************
+ *Function Name: lfuVictim
+ *
+ * Description: Remove least recently used unpinned frame of the lowest
+ *              bucket and return it, NULL if all pages are pinned
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *
+ * Return:
+ *     pageFrame*
+ ***************************************************************/
+pageFrame *lfuVictim(Linkedlist *pg){
+    freqBucket *bucket;
+    pageFrame *current=NULL;
+    for(bucket=pg->minBucket;bucket!=NULL && current==NULL;bucket=bucket->next)
+        current=listVictim(&bucket->frames);
+    if(current!=NULL)
+        lfuRemove(pg,current);
+    return current;
+}
+
+/****************************************************************
+ *Function Name: LFU
+ *
+ * Description: Implements least frequently used strategy. Frames are
+ *              kept in buckets of equal reference count, so a hit moves
+ *              the frame to the next bucket (hitFrame) and the victim
+ *              is the least recently used unpinned frame of the lowest
+ *              bucket, both in constant time. With an aging period all counts are
+ *              halved every agingPeriod pins
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *        BM_PageHandle *const page
+ *        PageNumber pageNum
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC LFU(BM_BufferPool *const bm, BM_PageHandle *const page, const  PageNumber pageNum){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    pageFrame *current;
+    if(pg->agingPeriod>0 && ++pg->timeStamp%pg->agingPeriod==0)
+        lfuAge(pg);
+    //fill empty frames first
+    current=getFreeFrame(pg);
+    if(current==NULL)
+        current=lfuVictim(pg);
+    if(current==NULL)
+        return RC_NO_UNPINNED_FRAME;
+    loadFrame(bm,current,page,pageNum);
+    lfuInsert(pg,current,NULL,1);
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: findGhost
+ *
+ * Description: Returns ghost entry of page pageNum or NULL
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *        PageNumber pageNum
+ *
+ * Return:
+ *     ghostEntry*
+ ***************************************************************/
+ghostEntry *findGhost(Linkedlist *pg, PageNumber pageNum){
+    int idx=lookupPage(&pg->ghostTable,pageNum);
+    if(idx==-1)
+        return NULL;
+    return &pg->ghostArena[idx];
+}
+
+/****************************************************************
+ *Function Name: ghostRemove
+ *
+ * Description: Remove entry from its ghost list and forget the page
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *        ghostEntry *entry
+ *
+ * Return:
+ *     void
+ ***************************************************************/
+void ghostRemove(Linkedlist *pg, ghostEntry *entry){
+    ghostList *lst=entry->owner;
+    if(entry->prev!=NULL)
+        entry->prev->next=entry->next;
+    else
+        lst->first=entry->next;
+    if(entry->next!=NULL)
+        entry->next->prev=entry->prev;
+    else
+        lst->last=entry->prev;
+    lst->size--;
+    removePage(&pg->ghostTable,entry->pageNo);
+    entry->owner=NULL;
+    entry->next=pg->freeGhosts;
+    pg->freeGhosts=entry;
+}
+
+/****************************************************************
+ *Function Name: ghostPush
+ *
+ * Description: Remember page pageNum at the front of ghost list. If
+ *              all entries are in use the oldest entry of the longer
+ *              ghost list is dropped
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *        ghostList *lst
+ *        PageNumber pageNum
+ *
+ * Return:
+ *     void
+ ***************************************************************/
+void ghostPush(Linkedlist *pg, ghostList *lst, PageNumber pageNum){
+    ghostEntry *entry;
+    if(pg->freeGhosts==NULL)
+        ghostRemove(pg, pg->ghostRecent.size>=pg->ghostFrequent.size ? pg->ghostRecent.last : pg->ghostFrequent.last);
+    entry=pg->freeGhosts;
+    pg->freeGhosts=entry->next;
+    entry->pageNo=pageNum;
+    entry->owner=lst;
+    entry->prev=NULL;
+    entry->next=lst->first;
+    if(lst->first!=NULL)
+        lst->first->prev=entry;
+    else
+        lst->last=entry;
+    lst->first=entry;
+    lst->size++;
+    insertPage(&pg->ghostTable,pageNum,entry-pg->ghostArena);
+}
+
+/****************************************************************
+ *Function Name: forgetGhost
+ *
+ * Description: Drop the ghost entry of page pageNum if the strategy of
+ *              the pool keeps ghost lists and remembers the page
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *        PageNumber pageNum
+ *
+ * Return:
+ *     void
+ ***************************************************************/
+void forgetGhost(Linkedlist *pg, PageNumber pageNum){
+    ghostEntry *entry;
+    if(pg->ghostArena==NULL)
+        return;
+    entry=findGhost(pg,pageNum);
+    if(entry!=NULL)
+        ghostRemove(pg,entry);
+}
+
+/****************************************************************
+ *Function Name: arcReplace
+ *
+ * Description: ARC replace step. Replace the least recently used
+ *              page of T1 (recent) if T1 is longer than the target
+ *              size, otherwise of T2 (frequent), and remember it in
+ *              ghost list B1 or B2. Pinned frames are skipped and the
+ *              other list is used if all frames of a list are pinned
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *        bool inFrequentGhost
+ *
+ * Return:
+ *     pageFrame*: frame to reuse or NULL
+ ***************************************************************/
+static pageFrame *arcReplace(Linkedlist *pg, bool inFrequentGhost){
+    pageFrame *victim=NULL;
+    bool fromRecent= pg->recent.size>0 && (pg->recent.size>pg->arcTarget || (inFrequentGhost && pg->recent.size==pg->arcTarget));
+    if(fromRecent)
+        victim=listVictim(&pg->recent);
+    if(victim==NULL){
+        victim=listVictim(&pg->frequent);
+        if(victim==NULL)
+            victim=listVictim(&pg->recent);
+    }
+    if(victim==NULL)
+        return NULL;
+    ghostPush(pg, victim->owner==&pg->recent ? &pg->ghostRecent : &pg->ghostFrequent, victim->pageNo);
+    listRemove(victim->owner,victim);
+    return victim;
+}
+
+/****************************************************************
+ *Function Name: ARC
+ *
+ * Description: Implements adaptive replacement cache. Pages used once
+ *              since they were loaded are kept in T1 (recent), pages
+ *              used again move to T2 (frequent) in hitFrame. Replaced pages are
+ *              remembered in ghost lists B1 and B2; a miss on a ghost
+ *              page moves the target size of T1 towards the list which
+ *              would have kept it
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *        BM_PageHandle *const page
+ *        PageNumber pageNum
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC ARC(BM_BufferPool *const bm, BM_PageHandle *const page, const  PageNumber pageNum){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    int c=__atomic_load_n(&pg->quota,__ATOMIC_RELAXED);
+    int delta;
+    bool inFrequentGhost=false;
+    bool toFrequent=false;
+    bool dropRecent=false;
+    ghostEntry *ghost;
+    pageFrame *current;
+    ghost=findGhost(pg,pageNum);
+    if(ghost!=NULL && ghost->owner==&pg->ghostRecent){
+        //T1 was too small, grow its target
+        delta= pg->ghostRecent.size>=pg->ghostFrequent.size ? 1 : pg->ghostFrequent.size/pg->ghostRecent.size;
+        pg->arcTarget= pg->arcTarget+delta<c ? pg->arcTarget+delta : c;
+        ghostRemove(pg,ghost);
+        toFrequent=true;
+    }
+    else if(ghost!=NULL){
+        //T2 was too small, shrink target of T1
+        delta= pg->ghostFrequent.size>=pg->ghostRecent.size ? 1 : pg->ghostRecent.size/pg->ghostFrequent.size;
+        pg->arcTarget= pg->arcTarget-delta>0 ? pg->arcTarget-delta : 0;
+        ghostRemove(pg,ghost);
+        toFrequent=true;
+        inFrequentGhost=true;
+    }
+    else if(pg->recent.size+pg->ghostRecent.size>=c){
+        if(pg->recent.size<c)
+            ghostRemove(pg,pg->ghostRecent.last);
+        else
+            dropRecent=true;
+    }
+    else if(pg->recent.size+pg->frequent.size+pg->ghostRecent.size+pg->ghostFrequent.size>=2*c && pg->ghostFrequent.last!=NULL)
+        ghostRemove(pg,pg->ghostFrequent.last);
+    //fill empty frames first
+    current=getFreeFrame(pg);
+    //T1 holds every frame, replace its oldest page without remembering it
+    if(current==NULL && dropRecent){
+        current=listVictim(&pg->recent);
+        if(current!=NULL)
+            listRemove(&pg->recent,current);
+    }
+    if(current==NULL)
+        current=arcReplace(pg,inFrequentGhost);
+    if(current==NULL)
+        return RC_NO_UNPINNED_FRAME;
+    loadFrame(bm,current,page,pageNum);
+    listPushFront(toFrequent ? &pg->frequent : &pg->recent,current);
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: twoQVictim
+ *
+ * Description: Remove the page to replace from A1in while it holds
+ *              more than kin frames, otherwise from Am, and return its
+ *              frame. Pages replaced from A1in are remembered in A1out
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *
+ * Return:
+ *     pageFrame*: frame or NULL if all pages are pinned
+ ***************************************************************/
+pageFrame *twoQVictim(Linkedlist *pg){
+    pageFrame *current=NULL;
+    if(pg->recent.size>pg->kin)
+        current=listVictim(&pg->recent);
+    if(current==NULL)
+        current=listVictim(&pg->frequent);
+    if(current==NULL)
+        current=listVictim(&pg->recent);
+    if(current==NULL)
+        return NULL;
+    //only pages replaced from A1in are remembered
+    if(current->owner==&pg->recent){
+        if(pg->ghostRecent.size>=pg->kout)
+            ghostRemove(pg,pg->ghostRecent.last);
+        ghostPush(pg,&pg->ghostRecent,current->pageNo);
+    }
+    listRemove(current->owner,current);
+    return current;
+}
+
+/****************************************************************
+ *Function Name: TWO_Q
+ *
+ * Description: Implements 2Q strategy. New pages enter FIFO queue A1in
+ *              (recent); pages replaced from A1in are remembered in
+ *              ghost queue A1out. A page loaded again while it is in
+ *              A1out goes to LRU list Am (frequent). Pages are replaced
+ *              from A1in while it holds more than kin frames,
+ *              otherwise from Am, so a scan only cycles through A1in
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *        BM_PageHandle *const page
+ *        PageNumber pageNum
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC TWO_Q(BM_BufferPool *const bm, BM_PageHandle *const page, const  PageNumber pageNum){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    bool toFrequent=false;
+    ghostEntry *ghost;
+    pageFrame *current;
+    ghost=findGhost(pg,pageNum);
+    if(ghost!=NULL){
+        ghostRemove(pg,ghost);
+        toFrequent=true;
+    }
+    //fill empty frames first
+    current=getFreeFrame(pg);
+    if(current==NULL)
+        current=twoQVictim(pg);
+    if(current==NULL)
+        return RC_NO_UNPINNED_FRAME;
+    loadFrame(bm,current,page,pageNum);
+    listPushFront(toFrequent ? &pg->frequent : &pg->recent,current);
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: selectVictim
+ *
+ * Description: Remove the page the replacement strategy of the pool
+ *              would replace next from the strategy bookkeeping and
+ *              return its frame
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *
+ * Return:
+ *     pageFrame*: frame or NULL if all pages are pinned
+ ***************************************************************/
+pageFrame *selectVictim(BM_BufferPool *const bm){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    if(bm->strategy==RS_FIFO)
+        return fifoVictim(pg);
+    if(bm->strategy==RS_LRU)
+        return lruVictim(pg);
+    if(bm->strategy==RS_CLOCK)
+        return clockVictim(pg);
+    if(bm->strategy==RS_LRU_K)
+        return lrukVictim(pg);
+    if(bm->strategy==RS_LFU)
+        return lfuVictim(pg);
+    if(bm->strategy==RS_ARC)
+        return arcReplace(pg,false);
+    if(bm->strategy==RS_2Q)
+        return twoQVictim(pg);
+    return NULL;
+}
+
+/****************************************************************
+ *Function Name: readmitFrame
+ *
+ * Description: Put the page of frame, which selectVictim removed from
+ *              the strategy bookkeeping, back as if it was just loaded,
+ *              and forget that it was replaced. FIFO and CLOCK keep all
+ *              frames in their ring
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *        pageFrame *frame
+ *
+ * Return:
+ *     void
+ ***************************************************************/
+void readmitFrame(BM_BufferPool *const bm, pageFrame *frame){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    if(bm->strategy==RS_LRU)
+        listPushFront(&pg->lruList,frame);
+    else if(bm->strategy==RS_LRU_K)
+        heapPush(pg,frame);
+    else if(bm->strategy==RS_LFU)
+        lfuInsert(pg,frame,NULL,1);
+    else if(bm->strategy==RS_ARC || bm->strategy==RS_2Q){
+        forgetGhost(pg,frame->pageNo);
+        listPushFront(&pg->recent,frame);
+    }
+}
+
+/****************************************************************
+ *Function Name: shrinkPool
+ *
+ * Description: Replace pages until the pool holds no more pages than
+ *              its quota. Stops early if the remaining pages are pinned,
+ *              the next pin tries again. Stops as well if a page cannot
+ *              be written back, it stays in the pool
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *
+ * Return:
+ *     RC: returned code, the error of the failed write-back
+ ***************************************************************/
+RC shrinkPool(BM_BufferPool *const bm){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    pageFrame *victim;
+    RC rc;
+    while(pg->numResident>__atomic_load_n(&pg->quota,__ATOMIC_RELAXED)){
+        victim=selectVictim(bm);
+        if(victim==NULL)
+            return RC_OK;
+        rc=releaseFrame(bm,victim);
+        if(rc!=RC_OK)
+            return rc;
+    }
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: initPoolRegistry
+ *
+ * Description: Set up the registry sharing frameBudget frames between
+ *              all buffer pools opened afterwards. Without a registry
+ *              every pool keeps all of its frames
+ *
+ * Parameter:
+ *        int frameBudget
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC initPoolRegistry(int frameBudget){
+    pthread_mutex_lock(&registryLatch);
+    if(registry.numPools>0){
+        pthread_mutex_unlock(&registryLatch);
+        return RC_POOL_REGISTRY_IN_USE;
+    }
+    free(registry.pools);
+    registry.pools=NULL;
+    registry.maxPools=0;
+    registry.budget= frameBudget>0 ? frameBudget : 0;
+    registry.assigned=0;
+    pthread_mutex_unlock(&registryLatch);
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: shutdownPoolRegistry
+ *
+ * Description: Remove the registry, pools opened afterwards are no
+ *              longer limited by a budget
+ *
+ * Parameter:
+ *        void
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC shutdownPoolRegistry(void){
+    pthread_mutex_lock(&registryLatch);
+    if(registry.numPools>0){
+        pthread_mutex_unlock(&registryLatch);
+        return RC_POOL_REGISTRY_IN_USE;
+    }
+    free(registry.pools);
+    memset(&registry,0,sizeof(poolRegistry));
+    pthread_mutex_unlock(&registryLatch);
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: registerPool
+ *
+ * Description: Add pool to the registry and give it as many frames of
+ *              the unassigned budget as it has, at least one
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC registerPool(BM_BufferPool *const bm){
+    Linkedlist *pg=(Linkedlist*)bm->mgmtData;
+    int unassigned;
+    pthread_mutex_lock(&registryLatch);
+    unassigned=registry.budget-registry.assigned;
+    if(registry.budget==0 || unassigned<=0){
+        pthread_mutex_unlock(&registryLatch);
+        return registry.budget==0 ? RC_OK : RC_FRAME_BUDGET_EXHAUSTED;
+    }
+    if(registry.numPools==registry.maxPools){
+        registry.maxPools= registry.maxPools>0 ? registry.maxPools*2 : 4;
+        registry.pools=(BM_BufferPool**)realloc(registry.pools,sizeof(BM_BufferPool*)*registry.maxPools);
+    }
+    registry.pools[registry.numPools++]=bm;
+    __atomic_store_n(&pg->quota,bm->numPages<unassigned ? bm->numPages : unassigned,__ATOMIC_RELAXED);
+    registry.assigned+=pg->quota;
+    pthread_mutex_unlock(&registryLatch);
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: unregisterPool
+ *
+ * Description: Remove pool from the registry and return its quota to
+ *              the unassigned budget
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *
+ * Return:
+ *     void
+ ***************************************************************/
+void unregisterPool(BM_BufferPool *const bm){
+    int i;
+    pthread_mutex_lock(&registryLatch);
+    for(i=0;i<registry.numPools;i++){
+        if(registry.pools[i]==bm){
+            registry.assigned-=((Linkedlist*)bm->mgmtData)->quota;
+            registry.pools[i]=registry.pools[--registry.numPools];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&registryLatch);
+}
+
+/****************************************************************
+ *Function Name: hitRatio
+ *
+ * Description: Returns hit ratio of pool since the last rebalance,
+ *              -1 if the pool was not used at all
+ *
+ * Parameter:
+ *        Linkedlist *pg
+ *
+ * Return:
+ *     double
+ ***************************************************************/
+static double hitRatio(Linkedlist *pg){
+    long pins=0,reads;
+    int i;
+    for(i=0;i<pg->numShards;i++)
+        pins+=__atomic_load_n(&pg->shards[i].pins,__ATOMIC_RELAXED);
+    if(pins==0)
+        return -1;
+    //a miss pinned before the window was reset may count its read in it
+    reads=__atomic_load_n(&pg->windowReads,__ATOMIC_RELAXED);
+    if(reads>pins)
+        reads=pins;
+    return (double)(pins-reads)/pins;
+}
+
+/****************************************************************
+ *Function Name: rebalanceBufferPools
+ *
+ * Description: Move frames between registered pools based on their
+ *              hit ratio since the last rebalance. Pools which still
+ *              miss are served first from the unassigned budget, then
+ *              from the pools with the lowest hit ratio (idle pools
+ *              first), up to an eighth of the donor's quota per call.
+ *              Donors give back their frames right away as far as
+ *              their pages are unpinned and can be written back
+ *
+ * Parameter:
+ *        void
+ *
+ * Return:
+ *     RC: returned code, the error of the first write-back of a donor
+ *         which failed; its page stays in the donor pool
+ ***************************************************************/
+RC rebalanceBufferPools(void){
+    RC rc=RC_OK,rcShrink;
+    int n;
+    int i,j,lo,hi,step,swap;
+    int *order;
+    double *ratio;
+    Linkedlist *donor,*receiver;
+    BM_BufferPool *tmp;
+    pthread_mutex_lock(&registryLatch);
+    n=registry.numPools;
+    if(n==0){
+        pthread_mutex_unlock(&registryLatch);
+        return RC_OK;
+    }
+    ratio=(double*)malloc(sizeof(double)*n);
+    order=(int*)malloc(sizeof(int)*n);
+    for(i=0;i<n;i++){
+        ratio[i]=hitRatio((Linkedlist*)registry.pools[i]->mgmtData);
+        order[i]=i;
+    }
+    //sort pools by hit ratio, few pools are registered so insertion sort is enough
+    for(i=1;i<n;i++){
+        for(j=i;j>0 && ratio[order[j-1]]>ratio[order[j]];j--){
+            swap=order[j];
+            order[j]=order[j-1];
+            order[j-1]=swap;
+        }
+    }
+    //hand out unassigned frames to the pools with the best hit ratio first
+    for(i=n-1;i>=0 && registry.assigned<registry.budget;i--){
+        tmp=registry.pools[order[i]];
+        receiver=(Linkedlist*)tmp->mgmtData;
+        if(__atomic_load_n(&receiver->windowReads,__ATOMIC_RELAXED)==0 || receiver->quota>=tmp->numPages)
+            continue;
+        step=tmp->numPages-receiver->quota;
+        if(step>registry.budget-registry.assigned)
+            step=registry.budget-registry.assigned;
+        __atomic_add_fetch(&receiver->quota,step,__ATOMIC_RELAXED);
+        registry.assigned+=step;
+        wakeWaiters(receiver);
+    }
+    //move frames from pools with low hit ratio to pools with high hit ratio
+    lo=0;
+    hi=n-1;
+    while(lo<hi){
+        tmp=registry.pools[order[hi]];
+        receiver=(Linkedlist*)tmp->mgmtData;
+        if(__atomic_load_n(&receiver->windowReads,__ATOMIC_RELAXED)==0 || receiver->quota>=tmp->numPages){
+            hi--;
+            continue;
+        }
+        donor=(Linkedlist*)registry.pools[order[lo]]->mgmtData;
+        if(ratio[order[lo]]>=ratio[order[hi]])
+            break;
+        if(donor->quota<=1){
+            lo++;
+            continue;
+        }
+        step= donor->quota/8>0 ? donor->quota/8 : 1;
+        if(step>donor->quota-1)
+            step=donor->quota-1;
+        if(step>tmp->numPages-receiver->quota)
+            step=tmp->numPages-receiver->quota;
+        __atomic_sub_fetch(&donor->quota,step,__ATOMIC_RELAXED);
+        __atomic_add_fetch(&receiver->quota,step,__ATOMIC_RELAXED);
+        latch(donor,&donor->evictLatch);
+        latch(donor,&donor->replLatch);
+        rcShrink=shrinkPool(registry.pools[order[lo]]);
+        if(rc==RC_OK)
+            rc=rcShrink;
+        unlatch(donor,&donor->replLatch);
+        unlatch(donor,&donor->evictLatch);
+        wakeWaiters(receiver);
+        lo++;
+        hi--;
+    }
+    //start a new observation window
+    for(i=0;i<n;i++){
+        donor=(Linkedlist*)registry.pools[i]->mgmtData;
+        for(j=0;j<donor->numShards;j++)
+            __atomic_store_n(&donor->shards[j].pins,0,__ATOMIC_RELAXED);
+        __atomic_store_n(&donor->windowReads,0,__ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&registryLatch);
+    free(ratio);
+    free(order);
+    return rc;
+}
+
+/****************************************************************
+ *Function Name: getPoolQuota
+ *
+ * Description: Returns number of frames the pool may currently use
+ *
+ * Parameter:
+ *        BM_BufferPool *const bm
+ *
+ * Return:
+ *     int
+ ***************************************************************/
+int getPoolQuota(BM_BufferPool *const bm){
+    return __atomic_load_n(&((Linkedlist*)bm->mgmtData)->quota,__ATOMIC_RELAXED);
 }
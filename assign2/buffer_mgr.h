@@ -4,6 +4,9 @@
 // Include return codes and methods for logging errors
 #include "dberror.h"
 
+// Include PageNumber, pools keep pages of a page file
+#include "storage_mgr.h"
+
 // Include bool DT
 #include "dt.h"
 
@@ -13,13 +16,43 @@ typedef enum ReplacementStrategy {
   RS_LRU = 1,
   RS_CLOCK = 2,
   RS_LFU = 3,
-  RS_LRU_K = 4
+  RS_LRU_K = 4,
+  RS_ARC = 5,
+  RS_2Q = 6
 } ReplacementStrategy;
 
 // Data Types and Structures
-typedef int PageNumber;
 #define NO_PAGE -1
 
+// Parameters of RS_LRU_K, passed as stratData to initBufferPool
+typedef struct BM_LRUKParams {
+  int k;                // number of references remembered per page
+  int correlatedPeriod; // pins of a page closer than this count as one reference
+} BM_LRUKParams;
+
+// Parameters of RS_LFU, passed as stratData to initBufferPool
+typedef struct BM_LFUParams {
+  int agingPeriod;      // halve all reference counts every agingPeriod pins, 0 never
+} BM_LFUParams;
+
+// Parameters of RS_2Q, passed as stratData to initBufferPool
+typedef struct BM_2QParams {
+  int kin;              // frames kept in FIFO queue A1in before it gives up frames
+  int kout;             // number of replaced pages remembered in ghost queue A1out
+} BM_2QParams;
+
+// Options of initBufferPoolWithOptions, NULL gives the defaults
+typedef struct BM_PoolOptions {
+  bool concurrent;      // pool is shared by several threads
+  int numShards;        // page table latches in concurrent mode, 0 four per processor
+  int cleanerHigh;      // percent of frames dirty at which the background writer starts, 0 none
+  int cleanerLow;       // percent of frames dirty at which the background writer stops
+  bool directIO;        // open the page file with SM_OPEN_DIRECT, frames are the only cache
+  bool checksums;       // open the page file with SM_OPEN_CHECKSUM, pages verified on every read
+  int flushThreads;     // threads writing the runs of forceFlushPool, 0 BM_FLUSH_THREADS
+  int durability;       // SM_DURABILITY_* of the page file, forcePage and forceFlushPool sync by it
+} BM_PoolOptions;
+
 typedef struct BM_BufferPool {
   char *pageFile;
   int numPages;
@@ -44,6 +77,9 @@ typedef struct BM_PageHandle {
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, 
 		  const int numPages, ReplacementStrategy strategy, 
 		  void *stratData);
+RC initBufferPoolWithOptions(BM_BufferPool *const bm, const char *const pageFileName,
+		  const int numPages, ReplacementStrategy strategy,
+		  void *stratData, const BM_PoolOptions *options);
 RC shutdownBufferPool(BM_BufferPool *const bm);
 RC forceFlushPool(BM_BufferPool *const bm);
 
@@ -53,6 +89,9 @@ RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, 
 	    const PageNumber pageNum);
+RC prefetchPages (BM_BufferPool *const bm, const PageNumber *pageNums, int count);
+RC allocatePoolPage (BM_BufferPool *const bm, PageNumber *pageNum);
+RC freePoolPage (BM_BufferPool *const bm, const PageNumber pageNum);
 
 // Statistics Interface
 PageNumber *getFrameContents (BM_BufferPool *const bm);
@@ -60,5 +99,13 @@ bool *getDirtyFlags (BM_BufferPool *const bm);
 int *getFixCounts (BM_BufferPool *const bm);
 int getNumReadIO (BM_BufferPool *const bm);
 int getNumWriteIO (BM_BufferPool *const bm);
+int getPoolPageSize (BM_BufferPool *const bm);
+
+// Buffer Manager Interface Pool Registry
+// pools opened after initPoolRegistry share frameBudget frames
+RC initPoolRegistry(int frameBudget);
+RC shutdownPoolRegistry(void);
+RC rebalanceBufferPools(void);
+int getPoolQuota(BM_BufferPool *const bm);
 
 #endif
\ No newline at end of file
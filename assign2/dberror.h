@@ -3,7 +3,7 @@
 
 #include "stdio.h"
 
-/* module wide constants */
+/* module wide constants, PAGE_SIZE is the default size of a page file */
 #define PAGE_SIZE 4096
 
 /* return code definitions */
@@ -19,6 +19,22 @@ typedef int RC;
 #define RC_MISMATCH 5
 #define RC_PINNED_NOT_OUT 6
 #define RC_MATCH 8
+#define RC_BUFFER_ALLOC_FAILED 10
+#define RC_NO_UNPINNED_FRAME 11
+#define RC_FRAME_BUDGET_EXHAUSTED 12
+#define RC_POOL_REGISTRY_IN_USE 13
+#define RC_MAP_FAILED 14
+#define RC_BAD_ALIGNMENT 15
+#define RC_IO_QUEUE_FULL 16
+#define RC_CHECKSUM_MISMATCH 17
+#define RC_NO_CHECKSUMS 18
+#define RC_BAD_PAGE_SIZE 19
+#define RC_PAGE_NOT_ALLOCATED 20
+#define RC_FREE_LIST_DAMAGED 21
+#define RC_NO_FILE_HEADER 22
+#define RC_BAD_STRIPES 24
+#define RC_BAD_DURABILITY 25
+#define RC_PAGE_BUSY 26
 
 #define RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE 200
 #define RC_RM_EXPR_RESULT_IS_NOT_BOOLEAN 201
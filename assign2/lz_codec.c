@@ -0,0 +1,228 @@
+#include <stdint.h>
+#include <string.h>
+#include "lz_codec.h"
+
+//positions remembered by the compressor, indexed by a hash of 4 bytes
+#define LZ_HASH_BITS 12
+#define LZ_MIN_MATCH 4
+//misses in a row before the compressor starts skipping bytes
+#define LZ_SKIP_TRIGGER 6
+
+/****************************************************************
+ *Function Name: read32 / hash32
+ *
+ * Description: Load 4 bytes from any address / hash them to a slot of
+ *              the compressor's table
+ *
+ * Parameter:
+ *        const char *p / uint32_t v
+ *
+ * Return:
+ *     uint32_t
+ ***************************************************************/
+static uint32_t read32(const char *p){
+    uint32_t v;
+    memcpy(&v,p,4);
+    return v;
+}
+
+static uint32_t hash32(uint32_t v){
+    return (v*2654435761u)>>(32-LZ_HASH_BITS);
+}
+
+/****************************************************************
+ *Function Name: putLength
+ *
+ * Description: Append the part of a length that does not fit into its
+ *              4 bit field of the token, as bytes of 255 and a last
+ *              byte below 255
+ *
+ * Parameter:
+ *        char *dst
+ *        int op
+ *        int dstCap
+ *        int len: length minus 15
+ *
+ * Return:
+ *     int: new output position or -1 if dst is full
+ ***************************************************************/
+static int putLength(char *dst, int op, int dstCap, int len){
+    while(len>=255){
+        if(op>=dstCap)
+            return -1;
+        dst[op++]=(char)255;
+        len-=255;
+    }
+    if(op>=dstCap)
+        return -1;
+    dst[op++]=(char)len;
+    return op;
+}
+
+/****************************************************************
+ *Function Name: putSequence
+ *
+ * Description: Append one sequence: token (literal length, match
+ *              length-4), literals, and unless it is the last sequence
+ *              the 16 bit offset of the match
+ *
+ * Parameter:
+ *        char *dst
+ *        int op
+ *        int dstCap
+ *        const char *lit
+ *        int litLen
+ *        int offset: 0 for the last sequence
+ *        int matchLen
+ *
+ * Return:
+ *     int: new output position or -1 if dst is full
+ ***************************************************************/
+static int putSequence(char *dst, int op, int dstCap, const char *lit, int litLen, int offset, int matchLen){
+    int m= offset>0 ? matchLen-LZ_MIN_MATCH : 0;
+    if(op>=dstCap)
+        return -1;
+    dst[op++]=(char)(((litLen<15 ? litLen : 15)<<4) | (m<15 ? m : 15));
+    if(litLen>=15 && (op=putLength(dst,op,dstCap,litLen-15))<0)
+        return -1;
+    if(op+litLen>dstCap)
+        return -1;
+    memcpy(dst+op,lit,litLen);
+    op+=litLen;
+    if(offset==0)
+        return op;
+    if(op+2>dstCap)
+        return -1;
+    dst[op++]=(char)(offset&0xFF);
+    dst[op++]=(char)(offset>>8);
+    if(m>=15 && (op=putLength(dst,op,dstCap,m-15))<0)
+        return -1;
+    return op;
+}
+
+/****************************************************************
+ *Function Name: lzCompress
+ *
+ * Description: Compress srcLen bytes (at most LZ_MAX_BLOCK) into dst.
+ *              Greedy matching with one candidate per hash slot, so a
+ *              page takes a few microseconds. Stops as soon as the output
+ *              would not fit into dstCap bytes
+ *
+ * Parameter:
+ *        const char *src
+ *        int srcLen
+ *        char *dst
+ *        int dstCap
+ *
+ * Return:
+ *     int: compressed length or 0 if it does not fit into dstCap
+ ***************************************************************/
+int lzCompress(const char *src, int srcLen, char *dst, int dstCap){
+    uint16_t table[1<<LZ_HASH_BITS];
+    int ip=0,anchor=0,op=0,ref,len,misses=0;
+    uint32_t seq,h;
+    if(srcLen<0 || srcLen>LZ_MAX_BLOCK)
+        return 0;
+    memset(table,0,sizeof(table));
+    while(ip+LZ_MIN_MATCH<=srcLen){
+        seq=read32(src+ip);
+        h=hash32(seq);
+        ref=table[h];
+        table[h]=(uint16_t)ip;
+        if(ref<ip && read32(src+ref)==seq){
+            len=LZ_MIN_MATCH;
+            while(ip+len<srcLen && src[ref+len]==src[ip+len])
+                len++;
+            op=putSequence(dst,op,dstCap,src+anchor,ip-anchor,ip-ref,len);
+            if(op<0)
+                return 0;
+            ip+=len;
+            anchor=ip;
+            misses=0;
+        }
+        //data that does not compress is skipped over faster and faster
+        else
+            ip+=1+(misses++>>LZ_SKIP_TRIGGER);
+    }
+    op=putSequence(dst,op,dstCap,src+anchor,srcLen-anchor,0,0);
+    return op<0 ? 0 : op;
+}
+
+/****************************************************************
+ *Function Name: getLength
+ *
+ * Description: Add the extra length bytes following a token field of 15
+ *
+ * Parameter:
+ *        const char *src
+ *        int *ip
+ *        int srcLen
+ *        int len
+ *
+ * Return:
+ *     int: length or -1 if the input ends
+ ***************************************************************/
+static int getLength(const char *src, int *ip, int srcLen, int len){
+    unsigned char b;
+    do{
+        if(*ip>=srcLen)
+            return -1;
+        b=(unsigned char)src[(*ip)++];
+        len+=b;
+    }while(b==255 && len<=LZ_MAX_BLOCK);
+    return len;
+}
+
+/****************************************************************
+ *Function Name: lzDecompress
+ *
+ * Description: Decompress block produced by lzCompress into dstLen
+ *              bytes of dst. Every length and offset is checked, so
+ *              damaged input cannot write outside dst
+ *
+ * Parameter:
+ *        const char *src
+ *        int srcLen
+ *        char *dst
+ *        int dstLen
+ *
+ * Return:
+ *     int: bytes written to dst or -1 if src is not a valid block
+ ***************************************************************/
+int lzDecompress(const char *src, int srcLen, char *dst, int dstLen){
+    int ip=0,op=0,litLen,matchLen,offset,i;
+    unsigned char token;
+    while(ip<srcLen){
+        token=(unsigned char)src[ip++];
+        litLen=token>>4;
+        if(litLen==15 && (litLen=getLength(src,&ip,srcLen,litLen))<0)
+            return -1;
+        if(litLen>srcLen-ip || litLen>dstLen-op)
+            return -1;
+        memcpy(dst+op,src+ip,litLen);
+        ip+=litLen;
+        op+=litLen;
+        //last sequence has no match
+        if(ip==srcLen)
+            break;
+        if(ip+2>srcLen)
+            return -1;
+        offset=(unsigned char)src[ip] | (unsigned char)src[ip+1]<<8;
+        ip+=2;
+        matchLen=token&15;
+        if(matchLen==15 && (matchLen=getLength(src,&ip,srcLen,matchLen))<0)
+            return -1;
+        matchLen+=LZ_MIN_MATCH;
+        if(offset==0 || offset>op || matchLen>dstLen-op)
+            return -1;
+        //matches may overlap the bytes they produce
+        if(offset>=matchLen)
+            memcpy(dst+op,dst+op-offset,matchLen);
+        else{
+            for(i=0;i<matchLen;i++)
+                dst[op+i]=dst[op+i-offset];
+        }
+        op+=matchLen;
+    }
+    return op;
+}
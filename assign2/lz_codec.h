@@ -0,0 +1,11 @@
+#ifndef LZ_CODEC_H
+#define LZ_CODEC_H
+
+// largest block lzCompress accepts, match offsets stay below 64 KB
+#define LZ_MAX_BLOCK 65536
+
+// LZ77 block codec used for compressed page files
+int lzCompress (const char *src, int srcLen, char *dst, int dstCap);
+int lzDecompress (const char *src, int srcLen, char *dst, int dstLen);
+
+#endif
@@ -1,412 +1,3186 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
 #include "storage_mgr.h"
 #include "dberror.h"
+#include "lz_codec.h"
 
+//compressed pages are stored in whole sectors of the data file
+#define SM_SECTOR_SIZE 512
+#define SM_MAX_PAGE_SECTORS (SM_MAX_PAGE_SIZE/SM_SECTOR_SIZE)
+
+//header at the start of a page file, and of the page map of a compressed file
+typedef struct SM_FileHeader{
+    char magic[8];      //SM_FILE_MAGIC
+    uint32_t version;
+    uint32_t pageSize;
+    uint64_t freePages; //length of the chain of free pages
+    uint64_t freeHead;  //first free page, only valid if freePages>0
+    uint32_t stripes;   //member files of a tablespace, 0 for other files
+}SM_FileHeader;
+
+//header of version 1, written while page numbers had 32 bits
+typedef struct SM_FileHeaderV1{
+    char magic[8];
+    uint32_t version;
+    uint32_t pageSize;
+    uint32_t freePages;
+    uint32_t freeHead;
+    uint32_t stripes;
+}SM_FileHeaderV1;
+
+//start of a free page, next is the following page of the chain. Free
+//pages are zeroed, so records of version 1 with 32 bit next read the same
+typedef struct SM_FreeRecord{
+    char magic[8];      //SM_FREE_MAGIC
+    uint64_t next;
+}SM_FreeRecord;
+
+#define SM_FILE_MAGIC "SMPAGES"
+#define SM_FREE_MAGIC "SMFREEP"
+#define SM_FILE_VERSION 2
+//bytes in front of page 0, a whole block so pages stay aligned for direct I/O
+#define SM_HEADER_SIZE 4096
+//bytes in front of the first entry of a page map
+#define SM_MAP_HEADER_SIZE 64
+//bytes of the header of a tablespace in front of the names of its members
+#define SM_STRIPE_NAMES 64
+
+//entry of the page map of a compressed file, as stored in its .pmap file
+typedef struct SM_PageSlot{
+    uint32_t sector;
+    uint32_t length;    //0 page never written, pageSize stored uncompressed
+    uint32_t sectors;   //sectors reserved for the page
+}SM_PageSlot;
+
+//free runs of sectors of one length
+typedef struct SM_FreeList{
+    uint32_t *sector;
+    int count;
+    int cap;
+}SM_FreeList;
+
+//state of an open page file, kept in mgmtInfo of the file handle
+typedef struct SM_FileInfo{
+    int fd;
+    int flags;
+    //page size and bytes in front of page 0, 0 for files without header
+    int pageSize;
+    off_t dataOffset;
+    char *map;
+    size_t mapSize;
+    int extentPages;
+    PageNumber allocPages;
+    //held for writing while the file or its mapping grows
+    pthread_rwlock_t growLatch;
+    //background scrubber, its state and findings are protected by scrubLatch
+    pthread_t scrubber;
+    int scrubbing;
+    int scrubStop;
+    int scrubRate;
+    pthread_mutex_t scrubLatch;
+    pthread_cond_t scrubWake;
+    SM_ScrubStats scrubStats;
+    //chain of free pages, see allocatePage. Taken before growLatch
+    pthread_mutex_t freeLatch;
+    PageNumber freePages;
+    PageNumber freeHead;
+    //compressed files, pageMapFd is -1 otherwise. Protected by growLatch
+    int pageMapFd;
+    SM_PageSlot *pageMap;
+    PageNumber pageMapCap;
+    uint32_t endSector;
+    SM_FreeList freeSectors[SM_MAX_PAGE_SECTORS+1];
+    //members of a tablespace, page p is page p/stripes of member p%stripes.
+    //stripes is 0 for other files, fd then holds the pages
+    int stripes;
+    int stripeFd[SM_MAX_STRIPES];
+    //readahead window of readBlock, raFirst..raFirst+raCount-1 are in raBuf.
+    //raRun counts the steps forward (>0) or backward (<0) up to raLast.
+    //raPages is set under the latch but also read outside it, as raLast and
+    //raRun are by reads which cannot use the window: accessed atomically.
+    //A fill reads raFillFirst..raFillFirst+raFillCount-1 into raSpare
+    //outside the latch; raStale drops it if those pages were written meanwhile
+    pthread_mutex_t raLatch;
+    int raPages;
+    char *raBuf;
+    char *raSpare;
+    PageNumber raFirst;
+    int raCount;
+    PageNumber raLast;
+    int raRun;
+    int raFilling;
+    PageNumber raFillFirst;
+    int raFillCount;
+    int raStale;
+    //durability level, see syncPageFile. A sync covers the requests up
+    //to its ticket; tickets and syncing are protected by syncLatch
+    int durability;
+    pthread_mutex_t syncLatch;
+    pthread_cond_t syncDone;
+    long syncTickets;
+    long syncedTicket;
+    long failedTicket;
+    long syncGroup;     //tickets the last sync covered
+    int syncing;
+    //I/O counters, updated with atomics. nextPage follows the page
+    //transferred last, an I/O starting elsewhere is a seek
+    SM_IOStats ioStats;
+    PageNumber nextPage;
+}SM_FileInfo;
+
+//a mapping grows to at least twice its size and a multiple of this many pages
+#define SM_MAP_STEP 256
+//pages transferred by one preadv / pwritev call
+#define SM_MAX_IOV 256
+//steps of a run of readBlock calls before the readahead window is filled
+#define SM_READAHEAD_RUN 2
+//pages the scrubber verifies between two pauses
+#define SM_SCRUB_BATCH 16
+//reflected CRC32C (Castagnoli) polynomial
+#define SM_CRC32C_POLY 0x82F63B78u
+
+//one page I/O of an I/O queue
+typedef struct SM_IORequest{
+    void *userData;
+    struct iovec iov;
+    int write;
+    int check;
+    RC rc;
+    int next;
+    //file and page of a write, its readahead window is dropped on completion
+    SM_FileInfo *info;
+    PageNumber pageNum;
+    long start;         //ioClock when submitted
+    char *sealBuf;      //sealed copy written instead of the page of a checksummed file
+}SM_IORequest;
+
+//io_uring instance, ringFd is -1 if I/O is done synchronously
+struct SM_IOQueue{
+    int ringFd;
+    unsigned *sqTail;
+    unsigned *sqMask;
+    unsigned *sqArray;
+    unsigned sqEntries;
+    struct io_uring_sqe *sqes;
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned *cqMask;
+    struct io_uring_cqe *cqes;
+    void *sqRing;
+    size_t sqRingSize;
+    void *cqRing;
+    size_t cqRingSize;
+    size_t sqesSize;
+    int toSubmit;
+    int inFlight;
+    SM_IORequest *requests;
+    int freeRequest;
+    int doneFirst;
+    int doneLast;
+};
+
+
+/****************************************************************
+ *Function Name: initStorageManager
+ *
+ * Description: Initialise Storage Manager
+ *
+ * Parameter: void
+ *
+ * Return:
+ *     void
+ ***************************************************************/
+void initStorageManager(void){
+    printf("***Initialising Storage Manager***");
+}
+
+/****************************************************************
+ *Function Name: locatePage
+ *
+ * Description: Returns file descriptor and byte offset of page pageNum,
+ *              in its member file for a tablespace
+ *
+ * Parameter:
+ *        SM_FileHandle *fHandle
+ *        PageNumber pageNum
+ *        off_t *offset
+ *
+ * Return:
+ *     int: file descriptor
+ ***************************************************************/
+static int locatePage(SM_FileHandle *fHandle, PageNumber pageNum, off_t *offset){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    if(info->stripes>0){
+        *offset=(off_t)(pageNum/info->stripes)*info->pageSize;
+        return info->stripeFd[pageNum%info->stripes];
+    }
+    *offset=info->dataOffset+(off_t)pageNum*info->pageSize;
+    return info->fd;
+}
+
+/****************************************************************
+ *Function Name: stripePages
+ *
+ * Description: Returns how many of the first numPages pages lie in
+ *              member s of a tablespace, numPages for other files
+ *
+ * Parameter:
+ *        SM_FileInfo *info
+ *        int s
+ *        PageNumber numPages
+ *
+ * Return:
+ *     PageNumber: pages
+ ***************************************************************/
+static PageNumber stripePages(SM_FileInfo *info, int s, PageNumber numPages){
+    if(info->stripes==0)
+        return numPages;
+    return numPages/info->stripes+(s<numPages%info->stripes);
+}
+
+/****************************************************************
+ *Function Name: ioClock
+ *
+ * Description: Returns monotonic time in nanoseconds, a vDSO call
+ *
+ * Parameter: void
+ *
+ * Return:
+ *     long
+ ***************************************************************/
+static long ioClock(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC,&now);
+    return now.tv_sec*1000000000L+now.tv_nsec;
+}
+
+/****************************************************************
+ *Function Name: countIO
+ *
+ * Description: Count an I/O of bytes started at ioClock start in
+ *              stats and its latency histogram. An I/O of pages from
+ *              pageNum on which does not follow the last one is a seek;
+ *              pageNum is -1 for I/O without pages
+ *
+ * Parameter:
+ *        SM_FileInfo *info
+ *        SM_IOClassStats *stats: one of info->ioStats
+ *        PageNumber pageNum
+ *        int pages
+ *        long bytes
+ *        long start
+ *
+ * Return:
+ *     void
+ ***************************************************************/
+static void countIO(SM_FileInfo *info, SM_IOClassStats *stats, PageNumber pageNum, int pages, long bytes, long start){
+    long ns=ioClock()-start;
+    int bucket= ns>1 ? 63-__builtin_clzl((unsigned long)ns) : 0;
+    if(bucket>=SM_LATENCY_BUCKETS)
+        bucket=SM_LATENCY_BUCKETS-1;
+    __atomic_fetch_add(&stats->ops,1,__ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->bytes,bytes,__ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->latency[bucket],1,__ATOMIC_RELAXED);
+    if(pageNum>=0 && __atomic_exchange_n(&info->nextPage,pageNum+pages,__ATOMIC_RELAXED)!=pageNum)
+        __atomic_fetch_add(&info->ioStats.seeks,1,__ATOMIC_RELAXED);
+}
+
+/****************************************************************
+ *Function Name: readFull / writeFull
+ *
+ * Description: pread / pwrite len bytes at offset, continuing after
+ *              short transfers and interrupts. Bytes behind the end of
+ *              the file are read as zero
+ *
+ * Parameter:
+ *        int fd
+ *        char *buf
+ *        size_t len
+ *        off_t offset
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+static RC readFull(int fd, char *buf, size_t len, off_t offset){
+    ssize_t n;
+    while(len>0){
+        n=pread(fd,buf,len,offset);
+        if(n<0 && errno==EINTR)
+            continue;
+        if(n<0)
+            return RC_READ_NON_EXISTING_PAGE;
+        if(n==0){
+            memset(buf,0,len);
+            break;
+        }
+        buf+=n;
+        len-=n;
+        offset+=n;
+    }
+    return RC_OK;
+}
+
+static RC writeFull(int fd, const char *buf, size_t len, off_t offset){
+    ssize_t n;
+    while(len>0){
+        n=pwrite(fd,buf,len,offset);
+        if(n<0 && errno==EINTR)
+            continue;
+        if(n<=0)
+            return RC_WRITE_FAILED;
+        buf+=n;
+        len-=n;
+        offset+=n;
+    }
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: transferPages
+ *
+ * Description: Read (write 0) or write (write 1) count consecutive
+ *              pages of pageSize bytes starting at offset with preadv /
+ *              pwritev, up to SM_MAX_IOV pages per call. Continues after
+ *              short transfers; pages behind the end of the file read
+ *              as zero
+ *
+ * Parameter:
+ *        int fd
+ *        SM_PageHandle *pages
+ *        int count
+ *        int pageSize
+ *        off_t offset
+ *        int write
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+static RC transferPages(int fd, SM_PageHandle *pages, int count, int pageSize, off_t offset, int write){
+    struct iovec iov[SM_MAX_IOV];
+    ssize_t done;
+    int first,n,i;
+    for(first=0;first<count;first+=n){
+        n= count-first<SM_MAX_IOV ? count-first : SM_MAX_IOV;
+        for(i=0;i<n;i++){
+            iov[i].iov_base=pages[first+i];
+            iov[i].iov_len=pageSize;
+        }
+        i=0;
+        while(i<n){
+            done= write ? pwritev(fd,iov+i,n-i,offset) : preadv(fd,iov+i,n-i,offset);
+            if(done<0 && errno==EINTR)
+                continue;
+            if(done<0 || (done==0 && write))
+                return write ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+            if(done==0){
+                for(;i<n;i++)
+                    memset(iov[i].iov_base,0,iov[i].iov_len);
+                break;
+            }
+            offset+=done;
+            //skip buffers done, the first one left may be partly done
+            while(i<n && (size_t)done>=iov[i].iov_len){
+                done-=iov[i].iov_len;
+                i++;
+            }
+            if(done>0){
+                iov[i].iov_base=(char*)iov[i].iov_base+done;
+                iov[i].iov_len-=done;
+            }
+        }
+    }
+    return RC_OK;
+}
+
+static uint32_t crcTable[256];
+static int crcHardware;
+static pthread_once_t crcOnce=PTHREAD_ONCE_INIT;
+
+/****************************************************************
+ *Function Name: crcInit
+ *
+ * Description: Fill CRC32C table of the software fallback and check
+ *              once whether the processor has the SSE4.2 crc32 instruction
+ *
+ * Parameter: void
+ *
+ * Return:
+ *     void
+ ***************************************************************/
+static void crcInit(void){
+    uint32_t c;
+    int i,j;
+    for(i=0;i<256;i++){
+        c=(uint32_t)i;
+        for(j=0;j<8;j++)
+            c= (c&1) ? (c>>1)^SM_CRC32C_POLY : c>>1;
+        crcTable[i]=c;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    crcHardware=__builtin_cpu_supports("sse4.2");
+#endif
+}
+
+/****************************************************************
+ *Function Name: crcSoftware / crcSSE42
+ *
+ * Description: CRC32C of len bytes, one table lookup per byte / the
+ *              crc32 instruction on eight bytes at a time
+ *
+ * Parameter:
+ *        const char *buf
+ *        size_t len
+ *
+ * Return:
+ *     uint32_t
+ ***************************************************************/
+static uint32_t crcSoftware(const char *buf, size_t len){
+    uint32_t c=0xFFFFFFFFu;
+    while(len-->0)
+        c=crcTable[(c^(unsigned char)*buf++)&0xFF]^(c>>8);
+    return c^0xFFFFFFFFu;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+static uint32_t crcSSE42(const char *buf, size_t len){
+    unsigned long long c=0xFFFFFFFFu,v;
+    while(len>=8){
+        memcpy(&v,buf,8);
+        c=__builtin_ia32_crc32di(c,v);
+        buf+=8;
+        len-=8;
+    }
+    while(len-->0)
+        c=__builtin_ia32_crc32qi((unsigned int)c,(unsigned char)*buf++);
+    return (uint32_t)c^0xFFFFFFFFu;
+}
+#endif
+
+/****************************************************************
+ *Function Name: pageChecksum
+ *
+ * Description: CRC32C of a page without its trailer
+ *
+ * Parameter:
+ *        const char *page
+ *        int pageSize
+ *
+ * Return:
+ *     uint32_t
+ ***************************************************************/
+static uint32_t pageChecksum(const char *page, int pageSize){
+    pthread_once(&crcOnce,crcInit);
+#if defined(__x86_64__)
+    if(crcHardware)
+        return crcSSE42(page,pageSize-SM_CHECKSUM_SIZE);
+#endif
+    return crcSoftware(page,pageSize-SM_CHECKSUM_SIZE);
+}
+
+/****************************************************************
+ *Function Name: sealPage / checkPage
+ *
+ * Description: Store checksum of page in its trailer (little endian) /
+ *              compare it with the trailer. A page of zero bytes was
+ *              never written and is valid
+ *
+ * Parameter:
+ *        char *page
+ *        int pageSize
+ *
+ * Return:
+ *     void / RC: RC_OK or RC_CHECKSUM_MISMATCH
+ ***************************************************************/
+static void sealPage(char *page, int pageSize){
+    uint32_t c=pageChecksum(page,pageSize);
+    unsigned char *trailer=(unsigned char*)page+pageSize-SM_CHECKSUM_SIZE;
+    trailer[0]=c&0xFF;
+    trailer[1]=(c>>8)&0xFF;
+    trailer[2]=(c>>16)&0xFF;
+    trailer[3]=c>>24;
+}
+
+static RC checkPage(const char *page, int pageSize){
+    const unsigned char *trailer=(const unsigned char*)page+pageSize-SM_CHECKSUM_SIZE;
+    uint32_t stored=trailer[0] | (uint32_t)trailer[1]<<8 | (uint32_t)trailer[2]<<16 | (uint32_t)trailer[3]<<24;
+    int i;
+    if(pageChecksum(page,pageSize)==stored)
+        return RC_OK;
+    for(i=0;i<pageSize;i++){
+        if(page[i]!=0)
+            return RC_CHECKSUM_MISMATCH;
+    }
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: sealCopies
+ *
+ * Description: Copy count pages into one aligned buffer and seal the
+ *              copies, sealed[i] is the copy of pages[i]. The pages of
+ *              the caller are not changed; a buffer pool frame may be
+ *              read by other threads while it is written
+ *
+ * Parameter:
+ *        SM_FileInfo *info
+ *        SM_PageHandle *pages
+ *        int count
+ *        SM_PageHandle *sealed: may be pages
+ *
+ * Return:
+ *     char*: buffer to free after the write, NULL if out of memory
+ ***************************************************************/
+static char *sealCopies(SM_FileInfo *info, SM_PageHandle *pages, int count, SM_PageHandle *sealed){
+    char *copies;
+    int i;
+    if(posix_memalign((void**)&copies,SM_DIRECT_ALIGN,(size_t)count*info->pageSize)!=0)
+        return NULL;
+    //sealed may be pages itself
+    for(i=0;i<count;i++){
+        memcpy(copies+(size_t)i*info->pageSize,pages[i],info->pageSize);
+        sealed[i]=copies+(size_t)i*info->pageSize;
+        sealPage(sealed[i],info->pageSize);
+    }
+    return copies;
+}
+
+/****************************************************************
+ *Function Name: growTotal
+ *
+ * Description: Raise totalNumPages to numPages if it is smaller. Safe
+ *              when several threads write behind the end of the file
+ *
+ * Parameter:
+ *        SM_FileHandle *fHandle
+ *        PageNumber numPages
+ *
+ * Return:
+ *     void
+ ***************************************************************/
+static void growTotal(SM_FileHandle *fHandle, PageNumber numPages){
+    PageNumber total=__atomic_load_n(&fHandle->totalNumPages,__ATOMIC_RELAXED);
+    while(total<numPages && !__atomic_compare_exchange_n(&fHandle->totalNumPages,&total,numPages,1,__ATOMIC_RELAXED,__ATOMIC_RELAXED));
+}
+
+/****************************************************************
+ *Function Name: growMap
+ *
+ * Description: Make the mapping of a file opened with SM_OPEN_MMAP
+ *              cover numPages pages. The mapping grows in large steps
+ *              and may move, the caller holds the map latch for writing
+ *
+ * Parameter:
+ *        SM_FileInfo *info
+ *        PageNumber numPages
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+static RC growMap(SM_FileInfo *info, PageNumber numPages){
+    //the header is mapped as well, so page offsets are file offsets
+    size_t need=(size_t)info->dataOffset+(size_t)numPages*info->pageSize;
+    size_t step=(size_t)SM_MAP_STEP*info->pageSize;
+    size_t size;
+    void *map;
+    if(need<=info->mapSize)
+        return RC_OK;
+    size= info->mapSize*2>need ? info->mapSize*2 : need;
+    size=(size+step-1)/step*step;
+    //pages behind the end of the file are mapped but never handed out
+    if(info->map==NULL)
+        map=mmap(NULL,size,PROT_READ|PROT_WRITE,MAP_SHARED,info->fd,0);
+    else
+        map=mremap(info->map,info->mapSize,size,MREMAP_MAYMOVE);
+    if(map==MAP_FAILED)
+        return RC_MAP_FAILED;
+    info->map=(char*)map;
+    info->mapSize=size;
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: reserveExtents
+ *
+ * Description: Reserve disk blocks for the first numPages pages in
+ *              whole extents with one fallocate call per member file. The size of the
+ *              file is kept, so totalNumPages still follows the file
+ *              size. File systems without fallocate grow the file sparse.
+ *              The caller holds the grow latch for writing
+ *
+ * Parameter:
+ *        SM_FileInfo *info
+ *        PageNumber numPages
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+static RC reserveExtents(SM_FileInfo *info, PageNumber numPages){
+    PageNumber target,from,to;
+    int s,fd;
+    if(numPages<=info->allocPages)
+        return RC_OK;
+    target=((long)numPages+info->extentPages-1)/info->extentPages*info->extentPages;
+    //every member of a tablespace reserves its share of the extent
+    for(s=0;s<info->stripes || s==0;s++){
+        fd= info->stripes>0 ? info->stripeFd[s] : info->fd;
+        from=stripePages(info,s,info->allocPages);
+        to=stripePages(info,s,target);
+        if(to>from && fallocate(fd,FALLOC_FL_KEEP_SIZE,info->dataOffset+(off_t)from*info->pageSize,(off_t)(to-from)*info->pageSize)!=0
+           && errno!=EOPNOTSUPP && errno!=ENOSYS)
+            return RC_WRITE_FAILED;
+    }
+    info->allocPages=target;
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: pageMapName
+ *
+ * Description: Returns name of the page map of a compressed file,
+ *              fileName followed by ".pmap". The caller frees it
+ *
+ * Parameter:
+ *        const char *fileName
+ *
+ * Return:
+ *     char*
+ ***************************************************************/
+static char *pageMapName(const char *fileName){
+    char *name=(char*)malloc(strlen(fileName)+6);
+    strcpy(name,fileName);
+    strcat(name,".pmap");
+    return name;
+}
+
+/****************************************************************
+ *Function Name: growPageMap
+ *
+ * Description: Extend page map of a compressed file to numPages pages.
+ *              New pages have no sectors and read as zero. The caller
+ *              holds the grow latch for writing
+ *
+ * Parameter:
+ *        SM_FileInfo *info
+ *        PageNumber numPages
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+static RC growPageMap(SM_FileInfo *info, PageNumber numPages){
+    PageNumber cap=info->pageMapCap>0 ? info->pageMapCap : 64;
+    SM_PageSlot *pageMap;
+    if(numPages>info->pageMapCap){
+        while(cap<numPages)
+            cap*=2;
+        pageMap=(SM_PageSlot*)realloc(info->pageMap,sizeof(SM_PageSlot)*cap);
+        if(pageMap==NULL)
+            return RC_WRITE_FAILED;
+        memset(pageMap+info->pageMapCap,0,sizeof(SM_PageSlot)*(cap-info->pageMapCap));
+        info->pageMap=pageMap;
+        info->pageMapCap=cap;
+    }
+    if(ftruncate(info->pageMapFd,SM_MAP_HEADER_SIZE+(off_t)numPages*sizeof(SM_PageSlot))!=0)
+        return RC_WRITE_FAILED;
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: freeSectors / allocSectors
+ *
+ * Description: Give run of count sectors back / take a run of count
+ *              sectors, from the free runs of that length, by splitting
+ *              a longer free run, or behind the last sector in use. The
+ *              caller holds the grow latch for writing
+ *
+ * Parameter:
+ *        SM_FileInfo *info
+ *        uint32_t sector
+ *        int count
+ *
+ * Return:
+ *     void / uint32_t: first sector of the run
+ ***************************************************************/
+static void freeSectors(SM_FileInfo *info, uint32_t sector, int count){
+    SM_FreeList *lst=&info->freeSectors[count];
+    if(lst->count==lst->cap){
+        lst->cap= lst->cap>0 ? lst->cap*2 : 16;
+        lst->sector=(uint32_t*)realloc(lst->sector,sizeof(uint32_t)*lst->cap);
+    }
+    lst->sector[lst->count++]=sector;
+}
+
+static uint32_t allocSectors(SM_FileInfo *info, int count){
+    uint32_t sector;
+    int n;
+    for(n=count;n<=info->pageSize/SM_SECTOR_SIZE;n++){
+        if(info->freeSectors[n].count>0){
+            sector=info->freeSectors[n].sector[--info->freeSectors[n].count];
+            if(n>count)
+                freeSectors(info,sector+count,n-count);
+            return sector;
+        }
+    }
+    sector=info->endSector;
+    info->endSector+=count;
+    return sector;
+}
+
+/****************************************************************
+ *Function Name: loadPageMap
+ *
+ * Description: Read page map of a compressed file and find the free
+ *              runs of sectors between the pages, which pages left when
+ *              they grew and moved
+ *
+ * Parameter:
+ *        SM_FileInfo *info
+ *        PageNumber numPages
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+static int compareSlots(const void *a, const void *b){
+    uint32_t x=((const SM_PageSlot*)a)->sector;
+    uint32_t y=((const SM_PageSlot*)b)->sector;
+    return x<y ? -1 : x>y;
+}
+
+static RC loadPageMap(SM_FileInfo *info, PageNumber numPages){
+    SM_PageSlot *used;
+    uint32_t next=0,gap,run=info->pageSize/SM_SECTOR_SIZE;
+    int i,n=0;
+    if(growPageMap(info,numPages)!=RC_OK || readFull(info->pageMapFd,(char*)info->pageMap,sizeof(SM_PageSlot)*numPages,SM_MAP_HEADER_SIZE)!=RC_OK)
+        return RC_FILE_NOT_FOUND;
+    used=(SM_PageSlot*)malloc(sizeof(SM_PageSlot)*(numPages+1));
+    for(i=0;i<numPages;i++){
+        if(info->pageMap[i].sectors>run || info->pageMap[i].length>(uint32_t)info->pageSize){
+            free(used);
+            return RC_FILE_NOT_FOUND;
+        }
+        if(info->pageMap[i].sectors>0)
+            used[n++]=info->pageMap[i];
+    }
+    qsort(used,n,sizeof(SM_PageSlot),compareSlots);
+    for(i=0;i<n;i++){
+        //gaps are split into runs no longer than a page
+        for(gap=used[i].sector>next ? used[i].sector-next : 0;gap>0;){
+            freeSectors(info,next,gap<run ? (int)gap : (int)run);
+            next+= gap<run ? gap : run;
+            gap-= gap<run ? gap : run;
+        }
+        if(used[i].sector+used[i].sectors>next)
+            next=used[i].sector+used[i].sectors;
+    }
+    info->endSector=next;
+    free(used);
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: readCompressed / writeCompressed
+ *
+ * Description: Read page pageNum of a compressed file, only its
+ *              compressed bytes are read / compress memPage with
+ *              lzCompress and write it to fresh sectors, a free run or
+ *              behind the last sector. The page map entry is switched
+ *              afterwards and the old sectors become free, so a crash
+ *              leaves the entry on the old or the new page, never on a
+ *              half written one. Pages which do not compress are stored
+ *              as they are. The grow latch keeps writers off the sectors
+ *              while they are read
+ *
+ * Parameter:
+ *        SM_FileHandle *fHandle
+ *        PageNumber pageNum
+ *        SM_PageHandle memPage
+ *
+ * Return:
+ *     RC: returned code, RC_CHECKSUM_MISMATCH if the block is damaged
+ ***************************************************************/
+static RC readCompressed(SM_FileHandle *fHandle, PageNumber pageNum, SM_PageHandle memPage){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    char block[SM_MAX_PAGE_SIZE];
+    SM_PageSlot slot;
+    uint32_t pageSize=info->pageSize;
+    RC rc=RC_OK;
+    pthread_rwlock_rdlock(&info->growLatch);
+    slot=info->pageMap[pageNum];
+    if(slot.length==0)
+        memset(memPage,0,pageSize);
+    else if(slot.length==pageSize)
+        rc=readFull(info->fd,memPage,pageSize,(off_t)slot.sector*SM_SECTOR_SIZE);
+    else
+        rc=readFull(info->fd,block,slot.length,(off_t)slot.sector*SM_SECTOR_SIZE);
+    pthread_rwlock_unlock(&info->growLatch);
+    if(rc==RC_OK && slot.length>0 && slot.length<pageSize && lzDecompress(block,slot.length,memPage,pageSize)!=(int)pageSize)
+        rc=RC_CHECKSUM_MISMATCH;
+    return rc;
+}
+
+static RC writeCompressed(SM_FileHandle *fHandle, PageNumber pageNum, SM_PageHandle memPage){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    char block[SM_MAX_PAGE_SIZE];
+    SM_PageSlot *slot,fresh;
+    char *data=block;
+    int len,need;
+    RC rc=RC_OK;
+    len=lzCompress(memPage,info->pageSize,block,info->pageSize-1);
+    if(len==0){
+        data=memPage;
+        len=info->pageSize;
+    }
+    need=(len+SM_SECTOR_SIZE-1)/SM_SECTOR_SIZE;
+    pthread_rwlock_wrlock(&info->growLatch);
+    if(pageNum>=__atomic_load_n(&fHandle->totalNumPages,__ATOMIC_RELAXED))
+        rc=growPageMap(info,pageNum+1);
+    if(rc==RC_OK){
+        slot=&info->pageMap[pageNum];
+        fresh.sector=allocSectors(info,need);
+        fresh.sectors=need;
+        fresh.length=len;
+        //block first, a page map entry never points to unwritten sectors
+        rc=writeFull(info->fd,data,len,(off_t)fresh.sector*SM_SECTOR_SIZE);
+        if(rc==RC_OK)
+            rc=writeFull(info->pageMapFd,(char*)&fresh,sizeof(SM_PageSlot),SM_MAP_HEADER_SIZE+(off_t)pageNum*sizeof(SM_PageSlot));
+        if(rc!=RC_OK)
+            freeSectors(info,fresh.sector,need);
+        else{
+            if(slot->sectors>0)
+                freeSectors(info,slot->sector,slot->sectors);
+            *slot=fresh;
+            growTotal(fHandle,pageNum+1);
+        }
+    }
+    pthread_rwlock_unlock(&info->growLatch);
+    return rc;
+}
+
+/****************************************************************
+ *Function Name: growFile
+ *
+ * Description: Extend file to numPages pages with ftruncate. The new
+ *              pages are never written, they read as zero. The caller
+ *              holds the grow latch for writing
+ *
+ * Parameter:
+ *        SM_FileHandle *fHandle
+ *        PageNumber numPages
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+static RC growFile(SM_FileHandle *fHandle, PageNumber numPages){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    PageNumber total;
+    int s,fd;
+    long start=ioClock();
+    RC rc;
+    total=__atomic_load_n(&fHandle->totalNumPages,__ATOMIC_RELAXED);
+    if(total>=numPages)
+        return RC_OK;
+    //pages of a compressed file get sectors when they are written
+    if(info->pageMapFd>=0)
+        rc=growPageMap(info,numPages);
+    else
+        rc=reserveExtents(info,numPages);
+    for(s=0;rc==RC_OK && info->pageMapFd<0 && (s<info->stripes || s==0);s++){
+        fd= info->stripes>0 ? info->stripeFd[s] : info->fd;
+        if(ftruncate(fd,info->dataOffset+(off_t)stripePages(info,s,numPages)*info->pageSize)!=0)
+            rc=RC_WRITE_FAILED;
+    }
+    if(rc==RC_OK && (info->flags&SM_OPEN_MMAP))
+        rc=growMap(info,numPages);
+    if(rc!=RC_OK)
+        return rc;
+    growTotal(fHandle,numPages);
+    countIO(info,&info->ioStats.append,-1,0,(long)(numPages-total)*info->pageSize,start);
+    //last new page becomes the current page
+    __atomic_store_n(&fHandle->curPagePos,numPages-1,__ATOMIC_RELAXED);
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: validPageSize
+ *
+ * Description: Check that pageSize is a power of two between
+ *              SM_MIN_PAGE_SIZE and SM_MAX_PAGE_SIZE
+ *
+ * Parameter:
+ *        int pageSize
+ *
+ * Return:
+ *     int: 1 if files can use the page size
+ ***************************************************************/
+static int validPageSize(int pageSize){
+    return pageSize>=SM_MIN_PAGE_SIZE && pageSize<=SM_MAX_PAGE_SIZE && (pageSize&(pageSize-1))==0;
+}
+
+/****************************************************************
+ *Function Name: writeHeader / readHeader
+ *
+ * Description: Write header at the start of fd, zero padded to size
+ *              bytes / read it back. Both go through a block aligned
+ *              buffer, so they work on files opened with O_DIRECT.
+ *              Files written before page sizes were recorded have no
+ *              header, readHeader gives page size 0 for them. Headers of
+ *              version 1 are widened, the next header written is version 2
+ *
+ * Parameter:
+ *        int fd
+ *        SM_FileHeader *header
+ *        size_t size: SM_HEADER_SIZE or SM_MAP_HEADER_SIZE
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+static RC writeHeader(int fd, const SM_FileHeader *header, size_t size){
+    char *block;
+    RC rc;
+    if(posix_memalign((void**)&block,SM_DIRECT_ALIGN,SM_HEADER_SIZE)!=0)
+        return RC_WRITE_FAILED;
+    memset(block,0,size);
+    memcpy(block,header,sizeof(SM_FileHeader));
+    rc=writeFull(fd,block,size,0);
+    free(block);
+    return rc;
+}
+
+static RC readHeader(int fd, SM_FileHeader *header){
+    SM_FileHeaderV1 old;
+    char *block;
+    RC rc;
+    if(posix_memalign((void**)&block,SM_DIRECT_ALIGN,SM_HEADER_SIZE)!=0)
+        return RC_FILE_NOT_FOUND;
+    rc=readFull(fd,block,SM_HEADER_SIZE,0);
+    memcpy(header,block,sizeof(SM_FileHeader));
+    memcpy(&old,block,sizeof(SM_FileHeaderV1));
+    free(block);
+    if(rc!=RC_OK)
+        return RC_FILE_NOT_FOUND;
+    if(memcmp(header->magic,SM_FILE_MAGIC,sizeof(header->magic))!=0){
+        memset(header,0,sizeof(SM_FileHeader));
+        return RC_OK;
+    }
+    if(old.version==1){
+        header->version=SM_FILE_VERSION;
+        header->freePages=old.freePages;
+        header->freeHead=old.freeHead;
+        header->stripes=old.stripes;
+    }
+    if(header->version!=SM_FILE_VERSION || !validPageSize((int)header->pageSize))
+        return RC_BAD_PAGE_SIZE;
+    if(header->stripes>SM_MAX_STRIPES)
+        return RC_BAD_STRIPES;
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: readStripeNames
+ *
+ * Description: Read the header block of the tablespace fd into block,
+ *              an aligned buffer of SM_HEADER_SIZE bytes, and point
+ *              names[0..stripes-1] to the names of its members in it
+ *
+ * Parameter:
+ *        int fd
+ *        char *block
+ *        int stripes
+ *        char **names
+ *
+ * Return:
+ *     RC: returned code, RC_BAD_STRIPES if the names are damaged
+ ***************************************************************/
+static RC readStripeNames(int fd, char *block, int stripes, char **names){
+    char *name=block+SM_STRIPE_NAMES;
+    int s;
+    if(readFull(fd,block,SM_HEADER_SIZE,0)!=RC_OK)
+        return RC_FILE_NOT_FOUND;
+    for(s=0;s<stripes;s++){
+        if(name>=block+SM_HEADER_SIZE || *name=='\0' || memchr(name,'\0',block+SM_HEADER_SIZE-name)==NULL)
+            return RC_BAD_STRIPES;
+        names[s]=name;
+        name+=strlen(name)+1;
+    }
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: newHeader
+ *
+ * Description: Header of a new file of pageSize pages without free pages
+ *
+ * Parameter:
+ *        SM_FileHeader *header
+ *        int pageSize
+ *
+ * Return:
+ *     void
+ ***************************************************************/
+static void newHeader(SM_FileHeader *header, int pageSize){
+    memset(header,0,sizeof(SM_FileHeader));
+    memcpy(header->magic,SM_FILE_MAGIC,sizeof(header->magic));
+    header->version=SM_FILE_VERSION;
+    header->pageSize=pageSize;
+}
+
+/****************************************************************
+ *Function Name: createPageFile
+ *
+ * Description: Create new Page file of PAGE_SIZE pages and fill with
+ *              '\0' bytes.
+ *
+ * Parameter:
+ *        char *fileName
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC createPageFile(char *fileName){
+    return createPageFileWithSize(fileName,PAGE_SIZE);
+}
+
+/****************************************************************
+ *Function Name: createPageFileWithSize
+ *
+ * Description: Create new Page file of pageSize pages with one page of
+ *              '\0' bytes. The page size is recorded in a header of
+ *              SM_HEADER_SIZE bytes in front of page 0, openPageFile
+ *              reads it back into the pageSize of the file handle
+ *
+ * Parameter:
+ *        char *fileName
+ *        int pageSize: power of two, SM_MIN_PAGE_SIZE to SM_MAX_PAGE_SIZE
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC createPageFileWithSize(char *fileName, int pageSize){
+    SM_FileHeader header;
+    int fd;
+    RC rc;
+    char *mapName;
+    if(!validPageSize(pageSize))
+        return RC_BAD_PAGE_SIZE;
+    mapName=pageMapName(fileName);
+    //a page map left behind would make the file look compressed
+    unlink(mapName);
+    free(mapName);
+    //create file or truncate an existing one
+    fd=open(fileName,O_RDWR|O_CREAT|O_TRUNC,0644);
+    if(fd<0){
+        printf("unable to open file");
+        return RC_FILE_NOT_FOUND;
+    }
+    //header, then a new page of '\0' bytes which is never written
+    newHeader(&header,pageSize);
+    rc=writeHeader(fd,&header,SM_HEADER_SIZE);
+    if(rc==RC_OK && ftruncate(fd,SM_HEADER_SIZE+(off_t)pageSize)!=0)
+        rc=RC_WRITE_FAILED;
+    //close file
+    close(fd);
+    return rc;
+}
+
+/****************************************************************
+ *Function Name: createCompressedPageFile
+ *
+ * Description: Create new compressed page file of PAGE_SIZE pages
+ *
+ * Parameter:
+ *        char *fileName
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC createCompressedPageFile(char *fileName){
+    return createCompressedPageFileWithSize(fileName,PAGE_SIZE);
+}
+
+/****************************************************************
+ *Function Name: createCompressedPageFileWithSize
+ *
+ * Description: Create new compressed page file of pageSize pages with
+ *              one empty page: an empty data file and its page map
+ *              fileName.pmap, which records the page size. openPageFile
+ *              recognises the file by its page map, so callers use it
+ *              like any other page file
+ *
+ * Parameter:
+ *        char *fileName
+ *        int pageSize: power of two, SM_MIN_PAGE_SIZE to SM_MAX_PAGE_SIZE
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC createCompressedPageFileWithSize(char *fileName, int pageSize){
+    SM_FileHeader header;
+    char *mapName;
+    int fd,mapFd;
+    RC rc;
+    if(!validPageSize(pageSize))
+        return RC_BAD_PAGE_SIZE;
+    mapName=pageMapName(fileName);
+    fd=open(fileName,O_RDWR|O_CREAT|O_TRUNC,0644);
+    mapFd= fd<0 ? -1 : open(mapName,O_RDWR|O_CREAT|O_TRUNC,0644);
+    free(mapName);
+    if(mapFd<0){
+        if(fd>=0)
+            close(fd);
+        printf("unable to open file");
+        return RC_FILE_NOT_FOUND;
+    }
+    //page map entry of zero bytes is a page never written
+    newHeader(&header,pageSize);
+    rc=writeHeader(mapFd,&header,SM_MAP_HEADER_SIZE);
+    if(rc==RC_OK && ftruncate(mapFd,SM_MAP_HEADER_SIZE+sizeof(SM_PageSlot))!=0)
+        rc=RC_WRITE_FAILED;
+    close(mapFd);
+    close(fd);
+    return rc;
+}
+
+/****************************************************************
+ *Function Name: createTablespace
+ *
+ * Description: Create new tablespace of pageSize pages with one page of
+ *              '\0' bytes. Its pages are striped round-robin across the
+ *              member files dataFiles[0..numFiles-1], page p is page
+ *              p/numFiles of member p%numFiles, so members on different
+ *              devices share the I/O of a scan. fileName only holds the
+ *              header with the names of the members, openPageFile opens
+ *              them with it. The members hold pages only
+ *
+ * Parameter:
+ *        char *fileName
+ *        char *const *dataFiles: names of the members, as opened later
+ *        int numFiles: 1 to SM_MAX_STRIPES
+ *        int pageSize: power of two, SM_MIN_PAGE_SIZE to SM_MAX_PAGE_SIZE
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC createTablespace(char *fileName, char *const *dataFiles, int numFiles, int pageSize){
+    SM_FileHeader header;
+    char *block,*mapName;
+    size_t used=SM_STRIPE_NAMES,len;
+    int fd,s;
+    RC rc=RC_OK;
+    if(!validPageSize(pageSize))
+        return RC_BAD_PAGE_SIZE;
+    if(numFiles<1 || numFiles>SM_MAX_STRIPES)
+        return RC_BAD_STRIPES;
+    if(posix_memalign((void**)&block,SM_DIRECT_ALIGN,SM_HEADER_SIZE)!=0)
+        return RC_WRITE_FAILED;
+    memset(block,0,SM_HEADER_SIZE);
+    newHeader(&header,pageSize);
+    header.stripes=numFiles;
+    memcpy(block,&header,sizeof(header));
+    //names of the members follow each other, each ended by '\0'
+    for(s=0;s<numFiles && rc==RC_OK;s++){
+        len=strlen(dataFiles[s])+1;
+        if(len==1 || used+len>SM_HEADER_SIZE)
+            rc=RC_BAD_STRIPES;
+        else{
+            memcpy(block+used,dataFiles[s],len);
+            used+=len;
+        }
+    }
+    //every member starts empty but the first, which holds page 0
+    for(s=0;s<numFiles && rc==RC_OK;s++){
+        fd=open(dataFiles[s],O_RDWR|O_CREAT|O_TRUNC,0644);
+        if(fd<0)
+            rc=RC_FILE_NOT_FOUND;
+        else{
+            if(ftruncate(fd,s==0 ? pageSize : 0)!=0)
+                rc=RC_WRITE_FAILED;
+            close(fd);
+        }
+    }
+    if(rc==RC_OK){
+        mapName=pageMapName(fileName);
+        unlink(mapName);
+        free(mapName);
+        fd=open(fileName,O_RDWR|O_CREAT|O_TRUNC,0644);
+        if(fd<0)
+            rc=RC_FILE_NOT_FOUND;
+        else{
+            rc=writeFull(fd,block,SM_HEADER_SIZE,0);
+            close(fd);
+        }
+    }
+    free(block);
+    return rc;
+}
+
+/****************************************************************
+ *Function Name: openStripes
+ *
+ * Description: Open the members of the tablespace of info with the
+ *              flags of info and count the pages in them. The tablespace
+ *              file itself is reopened without O_DIRECT, only its header
+ *              is written from then on
+ *
+ * Parameter:
+ *        SM_FileInfo *info
+ *        char *fileName
+ *        int stripes
+ *        PageNumber *numPages: pages of the tablespace
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+static RC openStripes(SM_FileInfo *info, char *fileName, int stripes, PageNumber *numPages){
+    char *block,*names[SM_MAX_STRIPES];
+    struct stat st;
+    PageNumber pages;
+    int fd,s;
+    RC rc;
+    *numPages=0;
+    if(posix_memalign((void**)&block,SM_DIRECT_ALIGN,SM_HEADER_SIZE)!=0)
+        return RC_FILE_NOT_FOUND;
+    rc=readStripeNames(info->fd,block,stripes,names);
+    if(rc==RC_OK && (info->flags&SM_OPEN_DIRECT)){
+        fd=open(fileName,O_RDWR);
+        if(fd<0)
+            rc=RC_FILE_NOT_FOUND;
+        else{
+            close(info->fd);
+            info->fd=fd;
+        }
+    }
+    for(s=0;s<stripes && rc==RC_OK;s++){
+        fd=open(names[s],(info->flags&SM_OPEN_DIRECT) ? O_RDWR|O_DIRECT : O_RDWR);
+        if(fd<0 && errno==EINVAL)
+            fd=open(names[s],O_RDWR);
+        if(fd<0){
+            rc=RC_FILE_NOT_FOUND;
+            break;
+        }
+        info->stripeFd[info->stripes++]=fd;
+        if(fstat(fd,&st)!=0)
+            rc=RC_FILE_NOT_FOUND;
+        //the last page of member s decides if it is the longest
+        else if((pages=st.st_size/info->pageSize)>0 && (pages-1)*stripes+s+1>*numPages)
+            *numPages=(pages-1)*stripes+s+1;
+    }
+    free(block);
+    return rc;
+}
+
+/****************************************************************
+ *Function Name: openPageFile
+ *
+ * Description: Open an existing page file and initialize file handle
+ *
+ * Parameter:
+ *        char *fileName
+ *        SM_FileHandle *fHandle
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC openPageFile(char *fileName, SM_FileHandle *fHandle){
+    return openPageFileWithFlags(fileName,fHandle,0);
+}
+
+/****************************************************************
+ *Function Name: openPageFileWithFlags
+ *
+ * Description: Open an existing page file with SM_OPEN_* flags. The
+ *              page size is read from the header of the file into
+ *              fHandle->pageSize, files without header have PAGE_SIZE
+ *              pages. With SM_OPEN_MMAP the file is mapped and blocks
+ *              are copied from and to the mapping, getBlockPtr gives
+ *              direct access. With SM_OPEN_DIRECT reads and writes
+ *              bypass the page cache; file systems without O_DIRECT fall
+ *              back to buffered I/O, the alignment of buffers is checked
+ *              anyway. With SM_OPEN_CHECKSUM the last SM_CHECKSUM_SIZE
+ *              bytes of every page are set on writes and verified on
+ *              reads. Compressed files ignore SM_OPEN_MMAP and
+ *              SM_OPEN_DIRECT, tablespaces ignore SM_OPEN_MMAP and
+ *              open their members with the other flags
+ *
+ * Parameter:
+ *        char *fileName
+ *        SM_FileHandle *fHandle
+ *        int flags
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC openPageFileWithFlags(char *fileName, SM_FileHandle *fHandle, int flags){
+    SM_FileInfo *info;
+    SM_FileHeader header;
+    struct stat st,mapSt;
+    char *mapName=pageMapName(fileName);
+    int fd,mapFd,pageSize;
+    PageNumber pages;
+    off_t dataOffset=0;
+    RC rc=RC_OK;
+    memset(&header,0,sizeof(header));
+    //a page map marks a compressed file, its blocks are neither mapped nor aligned
+    mapFd=open(mapName,O_RDWR);
+    free(mapName);
+    if(mapFd>=0 && (fstat(mapFd,&mapSt)!=0 || (rc=readHeader(mapFd,&header))!=RC_OK || header.pageSize==0)){
+        close(mapFd);
+        return rc==RC_BAD_PAGE_SIZE ? rc : RC_FILE_NOT_FOUND;
+    }
+    if(mapFd>=0)
+        flags&=~(SM_OPEN_MMAP|SM_OPEN_DIRECT);
+    //Open an existing file for reading and writing
+    fd=open(fileName,(flags&SM_OPEN_DIRECT) ? O_RDWR|O_DIRECT : O_RDWR);
+    if(fd<0 && errno==EINVAL)
+        fd=open(fileName,O_RDWR);
+    if(fd<0){
+        if(mapFd>=0)
+            close(mapFd);
+        printf("unable to open file");
+        //return error if file does not exist
+        return RC_FILE_NOT_FOUND;
+    }
+    if(fstat(fd,&st)!=0)
+        rc=RC_FILE_NOT_FOUND;
+    //pages of a file with header start behind it
+    else if(mapFd<0 && st.st_size>=SM_HEADER_SIZE && (rc=readHeader(fd,&header))==RC_OK && header.pageSize>0 && header.stripes==0)
+        dataOffset=SM_HEADER_SIZE;
+    if(rc!=RC_OK){
+        if(mapFd>=0)
+            close(mapFd);
+        close(fd);
+        return rc;
+    }
+    pageSize= header.pageSize>0 ? (int)header.pageSize : PAGE_SIZE;
+    //pages of a tablespace are spread over several files, they cannot be mapped
+    if(header.stripes>0)
+        flags&=~SM_OPEN_MMAP;
+    info=(SM_FileInfo*)malloc(sizeof(SM_FileInfo));
+    info->fd=fd;
+    info->flags=flags;
+    info->pageSize=pageSize;
+    info->dataOffset=dataOffset;
+    info->map=NULL;
+    info->mapSize=0;
+    info->extentPages=SM_EXTENT_PAGES;
+    pthread_rwlock_init(&info->growLatch,NULL);
+    info->scrubbing=0;
+    memset(&info->scrubStats,0,sizeof(SM_ScrubStats));
+    info->scrubStats.lastCorruptPage=-1;
+    pthread_mutex_init(&info->scrubLatch,NULL);
+    pthread_cond_init(&info->scrubWake,NULL);
+    pthread_mutex_init(&info->freeLatch,NULL);
+    info->freePages=header.freePages;
+    info->freeHead=header.freeHead;
+    info->pageMapFd=mapFd;
+    info->pageMap=NULL;
+    info->pageMapCap=0;
+    info->endSector=0;
+    memset(info->freeSectors,0,sizeof(info->freeSectors));
+    info->stripes=0;
+    pthread_mutex_init(&info->raLatch,NULL);
+    info->raPages=SM_READAHEAD_PAGES;
+    info->raBuf=NULL;
+    info->raSpare=NULL;
+    info->raFirst=0;
+    info->raCount=0;
+    info->raLast=-1;
+    info->raRun=0;
+    info->raFilling=0;
+    info->raFillFirst=0;
+    info->raFillCount=0;
+    info->raStale=0;
+    info->durability=SM_DURABILITY_NONE;
+    pthread_mutex_init(&info->syncLatch,NULL);
+    pthread_cond_init(&info->syncDone,NULL);
+    info->syncTickets=0;
+    info->syncedTicket=0;
+    info->failedTicket=0;
+    info->syncGroup=1;
+    info->syncing=0;
+    memset(&info->ioStats,0,sizeof(SM_IOStats));
+    info->nextPage=0;
+    if(header.stripes>0)
+        rc=openStripes(info,fileName,header.stripes,&pages);
+    else if(mapFd>=0)
+        pages= mapSt.st_size>SM_MAP_HEADER_SIZE ? (mapSt.st_size-SM_MAP_HEADER_SIZE)/sizeof(SM_PageSlot) : 0;
+    else
+        pages= st.st_size>dataOffset ? (st.st_size-dataOffset)/pageSize : 0;
+    info->allocPages= rc==RC_OK ? pages : 0;
+    //Initialize file handle field
+    fHandle->fileName =fileName;
+    fHandle->curPagePos=0;
+    fHandle->totalNumPages=info->allocPages;
+    fHandle->pageSize=pageSize;
+    fHandle->mgmtInfo=info;
+    if(rc!=RC_OK){
+        closePageFile(fHandle);
+        return rc;
+    }
+    if(mapFd>=0 && loadPageMap(info,fHandle->totalNumPages)!=RC_OK){
+        closePageFile(fHandle);
+        return RC_FILE_NOT_FOUND;
+    }
+    if((flags&SM_OPEN_MMAP) && growMap(info,fHandle->totalNumPages)!=RC_OK){
+        closePageFile(fHandle);
+        return RC_MAP_FAILED;
+    }
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: closePageFile
+ *
+ * Description: Close an open page file, stopping its scrubber. Files
+ *              with a durability level are synced first; the file is
+ *              closed even if that fails
+ *
+ * Parameter:
+ *       SM_FileHandle *fHandle
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC closePageFile(SM_FileHandle *fHandle){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    RC rc;
+    int i;
+    if(info==NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    stopScrubber(fHandle);
+    rc=syncPageFile(fHandle);
+    //close opened page file
+    if(info->map!=NULL)
+        munmap(info->map,info->mapSize);
+    pthread_rwlock_destroy(&info->growLatch);
+    pthread_mutex_destroy(&info->scrubLatch);
+    pthread_cond_destroy(&info->scrubWake);
+    pthread_mutex_destroy(&info->freeLatch);
+    pthread_mutex_destroy(&info->raLatch);
+    free(info->raBuf);
+    free(info->raSpare);
+    pthread_mutex_destroy(&info->syncLatch);
+    pthread_cond_destroy(&info->syncDone);
+    if(info->pageMapFd>=0){
+        close(info->pageMapFd);
+        free(info->pageMap);
+        for(i=0;i<=SM_MAX_PAGE_SECTORS;i++)
+            free(info->freeSectors[i].sector);
+    }
+    for(i=0;i<info->stripes;i++)
+        close(info->stripeFd[i]);
+    close(info->fd);
+    free(info);
+    fHandle->mgmtInfo=NULL;
+    return rc;
+    
+}
+
+/****************************************************************
+ *Function Name: destroyPageFile
+ *
+ * Description: Delete page file and the page map of a compressed file
+ *              or the members of a tablespace
+ *
+ * Parameter:
+ *       char *fileName
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC destroyPageFile(char *fileName){
+    SM_FileHeader header;
+    char *mapName=pageMapName(fileName),*block,*names[SM_MAX_STRIPES];
+    int fd,s;
+    //members of a tablespace go with it
+    fd=open(fileName,O_RDONLY);
+    if(fd>=0 && readHeader(fd,&header)==RC_OK && header.stripes>0
+       && posix_memalign((void**)&block,SM_DIRECT_ALIGN,SM_HEADER_SIZE)==0){
+        if(readStripeNames(fd,block,header.stripes,names)==RC_OK){
+            for(s=0;s<(int)header.stripes;s++)
+                unlink(names[s]);
+        }
+        free(block);
+    }
+    if(fd>=0)
+        close(fd);
+    unlink(mapName);
+    free(mapName);
+    remove(fileName);
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: transferBlocks
+ *
+ * Description: Read (write 0) or write (write 1) count pages from
+ *              startPage on with transferPages. Consecutive pages of a
+ *              tablespace are spread over its members, every stripes-th
+ *              one follows the one before in the same member, so there
+ *              is one transfer per member
+ *
+ * Parameter:
+ *        SM_FileHandle *fHandle
+ *        PageNumber startPage
+ *        int count
+ *        SM_PageHandle *memPages
+ *        int write
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+static RC transferBlocks(SM_FileHandle *fHandle, PageNumber startPage, int count, SM_PageHandle *memPages, int write){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    SM_PageHandle *pages;
+    off_t offset;
+    int fd,s,i,n;
+    RC rc=RC_OK;
+    if(info->stripes==0){
+        fd=locatePage(fHandle,startPage,&offset);
+        return transferPages(fd,memPages,count,info->pageSize,offset,write);
+    }
+    pages=(SM_PageHandle*)malloc(sizeof(SM_PageHandle)*(count/info->stripes+1));
+    if(pages==NULL)
+        return write ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+    for(s=0;s<info->stripes && s<count && rc==RC_OK;s++){
+        n=0;
+        for(i=s;i<count;i+=info->stripes)
+            pages[n++]=memPages[i];
+        fd=locatePage(fHandle,startPage+s,&offset);
+        rc=transferPages(fd,pages,n,info->pageSize,offset,write);
+    }
+    free(pages);
+    return rc;
+}
+
+/****************************************************************
+ *Function Name: readPage / readPageAs
+ *
+ * Description: Read pageNumth block straight into memPage with pread,
+ *              so threads reading the same file do not share a file
+ *              position. Files opened with SM_OPEN_DIRECT need a buffer
+ *              aligned to SM_DIRECT_ALIGN. With SM_OPEN_CHECKSUM a page
+ *              whose trailer does not match is still read but
+ *              RC_CHECKSUM_MISMATCH is returned. readPage does not move
+ *              the current page position. readPageAs counts the read in
+ *              stats instead of ioStats.read; only reads counted there
+ *              count as seeks
+ *
+ * Parameter:
+ *        PageNumber pageNum
+ *        SM_FileHandle *fHandle
+ *        SM_PageHandle memPage
+ *        SM_IOClassStats *stats: one of ioStats of the file
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+static RC readPageAs(PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, SM_IOClassStats *stats){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    off_t offset;
+    int fd;
+    long start=ioClock();
+    RC rc=RC_OK;
+    //check if pageNum is a page of the file
+    if(pageNum<0 || pageNum>=__atomic_load_n(&fHandle->totalNumPages,__ATOMIC_RELAXED)){
+        //return error if pageNum is greater
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+    fd=locatePage(fHandle,pageNum,&offset);
+    //reads a block of the page size of the file
+    if(info->pageMapFd>=0)
+        rc=readCompressed(fHandle,pageNum,memPage);
+    else if(info->flags&SM_OPEN_MMAP){
+        pthread_rwlock_rdlock(&info->growLatch);
+        memcpy(memPage,info->map+offset,info->pageSize);
+        pthread_rwlock_unlock(&info->growLatch);
+    }
+    else if((info->flags&SM_OPEN_DIRECT) && (uintptr_t)memPage%SM_DIRECT_ALIGN!=0)
+        return RC_BAD_ALIGNMENT;
+    else
+        rc=readFull(fd,memPage,info->pageSize,offset);
+    if(rc==RC_OK)
+        countIO(info,stats,stats==&info->ioStats.read ? pageNum : -1,1,info->pageSize,start);
+    if(rc==RC_OK && (info->flags&SM_OPEN_CHECKSUM))
+        rc=checkPage(memPage,info->pageSize);
+    return rc;
+}
+
+static RC readPage(PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage){
+    return readPageAs(pageNum,fHandle,memPage,&((SM_FileInfo*)fHandle->mgmtInfo)->ioStats.read);
+}
+
+/****************************************************************
+ *Function Name: adviseWindow
+ *
+ * Description: Ask the kernel with posix_fadvise to read count pages
+ *              from first on into the page cache in the background,
+ *              one hint per member of a tablespace. Files opened with
+ *              SM_OPEN_DIRECT bypass the page cache and get no hint
+ *
+ * Parameter:
+ *        SM_FileHandle *fHandle
+ *        PageNumber first
+ *        int count
+ *
+ * Return:
+ *     void
+ ***************************************************************/
+static void adviseWindow(SM_FileHandle *fHandle, PageNumber first, int count){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    int members= info->stripes>0 ? info->stripes : 1;
+    off_t offset;
+    int fd,s;
+    if(info->flags&SM_OPEN_DIRECT)
+        return;
+    for(s=0;s<members && s<count;s++){
+        fd=locatePage(fHandle,first+s,&offset);
+        posix_fadvise(fd,offset,(off_t)((count-s+members-1)/members)*info->pageSize,POSIX_FADV_WILLNEED);
+    }
+}
+
+/****************************************************************
+ *Function Name: fillWindow
+ *
+ * Description: Read count pages from first on into buf in one
+ *              transfer, the next readahead window. The window after it,
+ *              size pages in the direction of the run, is advised to the
+ *              kernel, so it is cached by the time the run gets there.
+ *              Called without raLatch, buf belongs to the caller
+ *
+ * Parameter:
+ *        SM_FileHandle *fHandle
+ *        char *buf: room for count pages
+ *        PageNumber first
+ *        int count
+ *        int size: pages of a window
+ *        int forward
+ *        PageNumber total: pages of the file
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+static RC fillWindow(SM_FileHandle *fHandle, char *buf, PageNumber first, int count, int size, int forward, PageNumber total){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    SM_PageHandle pages[SM_MAX_READAHEAD];
+    PageNumber next;
+    int i;
+    long start;
+    RC rc;
+    for(i=0;i<count;i++)
+        pages[i]=buf+(size_t)i*info->pageSize;
+    start=ioClock();
+    rc=transferBlocks(fHandle,first,count,pages,0);
+    if(rc!=RC_OK)
+        return rc;
+    countIO(info,&info->ioStats.read,first,count,(long)count*info->pageSize,start);
+    next= forward ? first+count : first-size;
+    count=size;
+    if(next<0){
+        count+=(int)next;
+        next=0;
+    }
+    if(next+count>total)
+        count=(int)(total-next);
+    if(count>0)
+        adviseWindow(fHandle,next,count);
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: dropWindow
+ *
+ * Description: Empty the readahead window if it holds one of count
+ *              pages from first on, and drop a fill reading one of them,
+ *              called after they are written
+ *
+ * Parameter:
+ *        SM_FileInfo *info
+ *        PageNumber first
+ *        int count
+ *
+ * Return:
+ *     void
+ ***************************************************************/
+static void dropWindow(SM_FileInfo *info, PageNumber first, int count){
+    pthread_mutex_lock(&info->raLatch);
+    if(first<info->raFirst+info->raCount && info->raFirst<first+count)
+        info->raCount=0;
+    //the fill may have read the page before the write
+    if(info->raFilling && first<info->raFillFirst+info->raFillCount && info->raFillFirst<first+count)
+        info->raStale=1;
+    pthread_mutex_unlock(&info->raLatch);
+}
+
+/****************************************************************
+ *Function Name: readAhead
+ *
+ * Description: readPage through the readahead window of readBlock. A
+ *              read of the page after (before) the one read last extends
+ *              a forward (backward) run; once a run is SM_READAHEAD_RUN
+ *              steps long, a page outside the window refills it, so a
+ *              scan with readNextBlock or readPreviousBlock does one
+ *              large read per window instead of one per page. The fill
+ *              is read outside raLatch into a spare buffer which then
+ *              becomes the window, so other reads of the handle do not
+ *              wait for it; one fill runs at a time. Other reads go to
+ *              readPage. A read of a page which neither is next to nor
+ *              the page read last only resets the run and never takes
+ *              raLatch, nor does any read with readahead off. Mapped and
+ *              compressed files have no window, and neither have
+ *              SM_OPEN_DIRECT files, whose pages would be copied twice
+ *
+ * Parameter:
+ *        PageNumber pageNum
+ *        SM_FileHandle *fHandle
+ *        SM_PageHandle memPage
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+static RC readAhead(PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    PageNumber total,first,last;
+    int run,count,size,forward;
+    char *buf;
+    RC rc;
+    if((info->flags&(SM_OPEN_MMAP|SM_OPEN_DIRECT)) || info->pageMapFd>=0)
+        return readPage(pageNum,fHandle,memPage);
+    total=__atomic_load_n(&fHandle->totalNumPages,__ATOMIC_RELAXED);
+    if(pageNum<0 || pageNum>=total)
+        return RC_READ_NON_EXISTING_PAGE;
+    if(__atomic_load_n(&info->raPages,__ATOMIC_RELAXED)==0)
+        return readPage(pageNum,fHandle,memPage);
+    //a page away from the last one read starts no run and is read without the latch;
+    //the window is only a copy, the page on disk is as new
+    last=__atomic_load_n(&info->raLast,__ATOMIC_RELAXED);
+    if(pageNum<last-1 || pageNum>last+1){
+        __atomic_store_n(&info->raRun,0,__ATOMIC_RELAXED);
+        __atomic_store_n(&info->raLast,pageNum,__ATOMIC_RELAXED);
+        return readPage(pageNum,fHandle,memPage);
+    }
+    pthread_mutex_lock(&info->raLatch);
+    if(info->raPages==0){
+        pthread_mutex_unlock(&info->raLatch);
+        return readPage(pageNum,fHandle,memPage);
+    }
+    //readCurrentBlock reads the same page again and keeps the run
+    last=__atomic_load_n(&info->raLast,__ATOMIC_RELAXED);
+    run=__atomic_load_n(&info->raRun,__ATOMIC_RELAXED);
+    if(pageNum==last+1)
+        run= run>0 ? run+1 : 1;
+    else if(pageNum==last-1)
+        run= run<0 ? run-1 : -1;
+    else if(pageNum!=last)
+        run=0;
+    __atomic_store_n(&info->raLast,pageNum,__ATOMIC_RELAXED);
+    __atomic_store_n(&info->raRun,run,__ATOMIC_RELAXED);
+    if((pageNum<info->raFirst || pageNum>=info->raFirst+info->raCount) && (run>=SM_READAHEAD_RUN || run<=-SM_READAHEAD_RUN) && !info->raFilling){
+        size=info->raPages;
+        forward=run>0;
+        first= forward ? pageNum : pageNum-size+1;
+        if(first<0)
+            first=0;
+        count= forward ? size : (int)(pageNum-first+1);
+        if(forward && total-first<size)
+            count=(int)(total-first);
+        buf=info->raSpare;
+        info->raSpare=NULL;
+        info->raFilling=1;
+        info->raFillFirst=first;
+        info->raFillCount=count;
+        info->raStale=0;
+        pthread_mutex_unlock(&info->raLatch);
+        rc=RC_READ_NON_EXISTING_PAGE;
+        if(buf!=NULL || posix_memalign((void**)&buf,SM_DIRECT_ALIGN,(size_t)size*info->pageSize)==0)
+            rc=fillWindow(fHandle,buf,first,count,size,forward,total);
+        else
+            buf=NULL;
+        pthread_mutex_lock(&info->raLatch);
+        info->raFilling=0;
+        //the filled buffer becomes the window, the old window the spare
+        if(rc==RC_OK && !info->raStale){
+            info->raSpare=info->raBuf;
+            info->raBuf=buf;
+            info->raFirst=first;
+            info->raCount=count;
+        }
+        else if(info->raSpare==NULL && size==info->raPages)
+            info->raSpare=buf;
+        else
+            free(buf);
+    }
+    if(pageNum<info->raFirst || pageNum>=info->raFirst+info->raCount){
+        pthread_mutex_unlock(&info->raLatch);
+        return readPage(pageNum,fHandle,memPage);
+    }
+    memcpy(memPage,info->raBuf+(size_t)(pageNum-info->raFirst)*info->pageSize,info->pageSize);
+    pthread_mutex_unlock(&info->raLatch);
+    if(info->flags&SM_OPEN_CHECKSUM)
+        return checkPage(memPage,info->pageSize);
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: readBlock
+ *
+ * Description: Read pageNumth block into memPage through the readahead
+ *              window and make it the current page. Files opened with
+ *              SM_OPEN_DIRECT need a buffer aligned to SM_DIRECT_ALIGN.
+ *              With SM_OPEN_CHECKSUM a page whose trailer does not match
+ *              is still read but RC_CHECKSUM_MISMATCH is returned
+ *
+ * Parameter:
+ *        PageNumber pageNum
+ *        SM_FileHandle *fHandle
+ *        SM_PageHandle memPage
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC readBlock(PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage){
+    RC rc=readAhead(pageNum,fHandle,memPage);
+    //Update curPagePos to pageNum
+    if(rc==RC_OK || rc==RC_CHECKSUM_MISMATCH)
+        __atomic_store_n(&fHandle->curPagePos,pageNum,__ATOMIC_RELAXED);
+    return rc;
+    
+}
+
+
+/****************************************************************
+ *Function Name: getBlockPos
+ *
+ * Description: Return current page position, the page read or
+ *              written last
+ *
+ * Parameter:
+ *        SM_FileHandle *fHandle
+ *
+ * Return:
+ *       int
+ ***************************************************************/
+PageNumber getBlockPos(SM_FileHandle *fHandle){
+    return __atomic_load_n(&fHandle->curPagePos,__ATOMIC_RELAXED);
+}
+
+
+/****************************************************************
+ *Function Name: readFirstBlock
+ *
+ * Description: Read first block
+ *
+ * Parameter:
+ *        SM_FileHandle *fHandle
+ *        SM_PageHandle memPage
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC readFirstBlock(SM_FileHandle *fHandle, SM_PageHandle memPage){
+    return readBlock(0,fHandle,memPage);
+}
+
+
+/****************************************************************
+ *Function Name: readPreviousBlock
+ *
+ * Description: Read block before the current page
+ *
+ * Parameter:
+ *        SM_FileHandle *fHandle
+ *        SM_PageHandle memPage
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC readPreviousBlock(SM_FileHandle *fHandle, SM_PageHandle memPage){
+    return readBlock(getBlockPos(fHandle)-1,fHandle,memPage);
+}
+
+/****************************************************************
+ *Function Name: readCurrentBlock
+ *
+ * Description: Read current block
+ *
+ * Parameter:
+ *        SM_FileHandle *fHandle
+ *        SM_PageHandle memPage
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC readCurrentBlock(SM_FileHandle *fHandle, SM_PageHandle memPage){
+    return readBlock(getBlockPos(fHandle),fHandle,memPage);
+}
+
+/****************************************************************
+ *Function Name: readNextBlock
+ *
+ * Description: Read block after the current page
+ *
+ * Parameter:
+ *        SM_FileHandle *fHandle
+ *        SM_PageHandle memPage
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC readNextBlock(SM_FileHandle *fHandle, SM_PageHandle memPage){
+    return readBlock(getBlockPos(fHandle)+1,fHandle,memPage);
+}
+
+
+/****************************************************************
+ *Function Name: readLastBlock
+ *
+ * Description: Read last block
+ *
+ * Parameter:
+ *        SM_FileHandle *fHandle
+ *        SM_PageHandle memPage
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC readLastBlock(SM_FileHandle *fHandle, SM_PageHandle memPage){
+    return readBlock(__atomic_load_n(&fHandle->totalNumPages,__ATOMIC_RELAXED)-1,fHandle,memPage);
+}
+
+/****************************************************************
+ *Function Name: getBlockPtr
+ *
+ * Description: Return pointer to page pageNum inside the mapping of a
+ *              file opened with SM_OPEN_MMAP, without copying it. Changes
+ *              through the pointer go to the file. The pointer is valid
+ *              until the file grows or is closed, since the mapping may
+ *              move when it grows. Checksums are neither verified nor
+ *              updated for changes through the pointer
+ *
+ * Parameter:
+ *        PageNumber pageNum
+ *        SM_FileHandle *fHandle
+ *
+ * Return:
+ *     char*: page or NULL if the file is not mapped or has no such page
+ ***************************************************************/
+char *getBlockPtr(PageNumber pageNum, SM_FileHandle *fHandle){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    off_t offset;
+    if(info==NULL || !(info->flags&SM_OPEN_MMAP))
+        return NULL;
+    if(pageNum<0 || pageNum>=__atomic_load_n(&fHandle->totalNumPages,__ATOMIC_RELAXED))
+        return NULL;
+    locatePage(fHandle,pageNum,&offset);
+    __atomic_store_n(&fHandle->curPagePos,pageNum,__ATOMIC_RELAXED);
+    return info->map+offset;
+}
+
+/****************************************************************
+ *Function Name: alignedPages
+ *
+ * Description: Check that all buffers meet the alignment of a file
+ *              opened with SM_OPEN_DIRECT
+ *
+ * Parameter:
+ *        SM_FileInfo *info
+ *        SM_PageHandle *memPages
+ *        int count
+ *
+ * Return:
+ *     int: 1 if the buffers can be used
+ ***************************************************************/
+static int alignedPages(SM_FileInfo *info, SM_PageHandle *memPages, int count){
+    int i;
+    if(!(info->flags&SM_OPEN_DIRECT) || (info->flags&SM_OPEN_MMAP))
+        return 1;
+    for(i=0;i<count;i++){
+        if((uintptr_t)memPages[i]%SM_DIRECT_ALIGN!=0)
+            return 0;
+    }
+    return 1;
+}
+
+/****************************************************************
+ *Function Name: readBlocks
+ *
+ * Description: Read count pages from startPage on into memPages[0..
+ *              count-1] with a few large preadv calls. The last page
+ *              read becomes the current page. With SM_OPEN_CHECKSUM all
+ *              pages are read and RC_CHECKSUM_MISMATCH is returned if
+ *              one of them does not match
+ *
+ * Parameter:
+ *        PageNumber startPage
+ *        int count
+ *        SM_FileHandle *fHandle
+ *        SM_PageHandle *memPages: one page buffer per page
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC readBlocks(PageNumber startPage, int count, SM_FileHandle *fHandle, SM_PageHandle *memPages){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    off_t offset;
+    int i;
+    long start=ioClock();
+    RC rc=RC_OK,ret;
+    //all pages have to be in the file
+    if(startPage<0 || count<=0 || count>__atomic_load_n(&fHandle->totalNumPages,__ATOMIC_RELAXED)-startPage)
+        return RC_READ_NON_EXISTING_PAGE;
+    if(!alignedPages(info,memPages,count))
+        return RC_BAD_ALIGNMENT;
+    locatePage(fHandle,startPage,&offset);
+    //compressed pages have no fixed place, they are read one by one
+    if(info->pageMapFd>=0){
+        for(i=0;i<count && rc!=RC_READ_NON_EXISTING_PAGE;i++){
+            if((ret=readCompressed(fHandle,startPage+i,memPages[i]))!=RC_OK)
+                rc=ret;
+        }
+    }
+    else if(info->flags&SM_OPEN_MMAP){
+        pthread_rwlock_rdlock(&info->growLatch);
+        for(i=0;i<count;i++)
+            memcpy(memPages[i],info->map+offset+(off_t)i*info->pageSize,info->pageSize);
+        pthread_rwlock_unlock(&info->growLatch);
+    }
+    else
+        rc=transferBlocks(fHandle,startPage,count,memPages,0);
+    if(rc!=RC_OK && rc!=RC_CHECKSUM_MISMATCH)
+        return rc;
+    countIO(info,&info->ioStats.read,startPage,count,(long)count*info->pageSize,start);
+    for(i=0;i<count && (info->flags&SM_OPEN_CHECKSUM);i++){
+        if(checkPage(memPages[i],info->pageSize)!=RC_OK)
+            rc=RC_CHECKSUM_MISMATCH;
+    }
+    __atomic_store_n(&fHandle->curPagePos,startPage+count-1,__ATOMIC_RELAXED);
+    return rc;
+}
 
 /****************************************************************
- *Function Name: initStorageManager
+ *Function Name: writeBlock / writePage
  *
- * Description: Initialise Storage Manager
+ * Description: write pageNumth block with pwrite. Writing behind the
+ *              end of the file grows it, pages skipped over read as zero.
+ *              Files opened with SM_OPEN_DIRECT need an aligned buffer.
+ *              With SM_OPEN_CHECKSUM a copy of memPage with the checksum in
+ *              its trailer is written. writePage does not move the
+ *              current page position
  *
- * Parameter: void
+ * Parameter:
+ *        PageNumber pageNum
+ *        SM_FileHandle *fHandle
+ *        SM_PageHandle memPage
  *
  * Return:
- *     void
+ *     RC: returned code
  ***************************************************************/
-void initStorageManager(void){
-    printf("***Initialising Storage Manager***");
+static RC writePage(PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    off_t offset;
+    PageNumber total;
+    int fd;
+    long start=ioClock();
+    char *copy=NULL;
+    RC rc;
+    if(pageNum<0)
+        return RC_WRITE_FAILED;
+    total=__atomic_load_n(&fHandle->totalNumPages,__ATOMIC_RELAXED);
+    fd=locatePage(fHandle,pageNum,&offset);
+    if((info->flags&SM_OPEN_DIRECT) && !(info->flags&SM_OPEN_MMAP) && (uintptr_t)memPage%SM_DIRECT_ALIGN!=0)
+        return RC_BAD_ALIGNMENT;
+    if((info->flags&SM_OPEN_CHECKSUM) && (copy=sealCopies(info,&memPage,1,&memPage))==NULL)
+        return RC_WRITE_FAILED;
+    if(info->pageMapFd>=0)
+        rc=writeCompressed(fHandle,pageNum,memPage);
+    else if(pageNum<__atomic_load_n(&fHandle->totalNumPages,__ATOMIC_RELAXED) && !(info->flags&SM_OPEN_MMAP))
+        rc=writeFull(fd,memPage,info->pageSize,offset);
+    //pages of the file are written through the mapping
+    else if(pageNum<__atomic_load_n(&fHandle->totalNumPages,__ATOMIC_RELAXED)){
+        pthread_rwlock_rdlock(&info->growLatch);
+        memcpy(info->map+offset,memPage,info->pageSize);
+        pthread_rwlock_unlock(&info->growLatch);
+        rc=RC_OK;
+    }
+    //writing behind the end grows the file by whole extents
+    else{
+        pthread_rwlock_wrlock(&info->growLatch);
+        rc=reserveExtents(info,pageNum+1);
+        if(rc==RC_OK)
+            rc=writeFull(fd,memPage,info->pageSize,offset);
+        if(rc==RC_OK && (info->flags&SM_OPEN_MMAP))
+            rc=growMap(info,pageNum+1);
+        //raised under the latch, so growFile never cuts the page off again
+        if(rc==RC_OK)
+            growTotal(fHandle,pageNum+1);
+        pthread_rwlock_unlock(&info->growLatch);
+    }
+    free(copy);
+    //a partly written page is dropped as well
+    dropWindow(info,pageNum,1);
+    if(rc==RC_OK && pageNum<total)
+        countIO(info,&info->ioStats.write,pageNum,1,info->pageSize,start);
+    else if(rc==RC_OK)
+        countIO(info,&info->ioStats.append,pageNum,1,(long)(pageNum+1-total)*info->pageSize,start);
+    return rc;
+}
+
+RC writeBlock(PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage){
+    RC rc=writePage(pageNum,fHandle,memPage);
+    //Update current page position to pageNum
+    if(rc==RC_OK)
+        __atomic_store_n(&fHandle->curPagePos,pageNum,__ATOMIC_RELAXED);
+    return rc;
 }
 
+
 /****************************************************************
- *Function Name: createPageFile
+ *Function Name: writeCurrentBlock
  *
- * Description: Create new Page file and fill with '\0' bytes.
+ * Description: write current block
  *
  * Parameter:
- *        char *fileName
+ *        SM_FileHandle *fHandle
+ *        SM_PageHandle memPage
+ *
  * Return:
  *     RC: returned code
  ***************************************************************/
-RC createPageFile(char *fileName){
-    FILE *fp;
-    //open file in write binary mode
-    fp=fopen(fileName, "wb");
-    if(fp==NULL){
-        printf("unable to open file");
-        return RC_FILE_NOT_FOUND;
-    }
+RC writeCurrentBlock(SM_FileHandle *fHandle, SM_PageHandle memPage){
+    return writeBlock(getBlockPos(fHandle),fHandle,memPage);
+}
+
+/****************************************************************
+ *Function Name: writeBlocks
+ *
+ * Description: Write memPages[0..count-1] to count pages from startPage
+ *              on with a few large pwritev calls. Writing behind the end
+ *              grows the file by whole extents. The last page written
+ *              becomes the current page. With SM_OPEN_CHECKSUM sealed
+ *              copies of the pages are written
+ *
+ * Parameter:
+ *        PageNumber startPage
+ *        int count
+ *        SM_FileHandle *fHandle
+ *        SM_PageHandle *memPages: one page buffer per page
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC writeBlocks(PageNumber startPage, int count, SM_FileHandle *fHandle, SM_PageHandle *memPages){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    off_t offset;
+    PageNumber total;
     int i;
-    //fill new page with '\0' bytes
-    for(i=0;i<PAGE_SIZE;i++){
-        fwrite("\0",sizeof(char),1,fp);
-        
+    long start=ioClock();
+    SM_PageHandle *sealed=NULL;
+    char *copies=NULL;
+    RC rc=RC_OK;
+    if(startPage<0 || count<=0)
+        return RC_WRITE_FAILED;
+    total=__atomic_load_n(&fHandle->totalNumPages,__ATOMIC_RELAXED);
+    if(!alignedPages(info,memPages,count))
+        return RC_BAD_ALIGNMENT;
+    if(info->flags&SM_OPEN_CHECKSUM){
+        sealed=(SM_PageHandle*)malloc(sizeof(SM_PageHandle)*count);
+        if(sealed==NULL || (copies=sealCopies(info,memPages,count,sealed))==NULL){
+            free(sealed);
+            return RC_WRITE_FAILED;
+        }
+        memPages=sealed;
     }
-    //close file
-    fclose(fp);
+    locatePage(fHandle,startPage,&offset);
+    if(info->pageMapFd>=0){
+        for(i=0;i<count && rc==RC_OK;i++)
+            rc=writeCompressed(fHandle,startPage+i,memPages[i]);
+    }
+    else if(startPage+count<=__atomic_load_n(&fHandle->totalNumPages,__ATOMIC_RELAXED) && !(info->flags&SM_OPEN_MMAP))
+        rc=transferBlocks(fHandle,startPage,count,memPages,1);
+    //pages of the file are written through the mapping
+    else if(startPage+count<=__atomic_load_n(&fHandle->totalNumPages,__ATOMIC_RELAXED)){
+        pthread_rwlock_rdlock(&info->growLatch);
+        for(i=0;i<count;i++)
+            memcpy(info->map+offset+(off_t)i*info->pageSize,memPages[i],info->pageSize);
+        pthread_rwlock_unlock(&info->growLatch);
+    }
+    else{
+        pthread_rwlock_wrlock(&info->growLatch);
+        rc=reserveExtents(info,startPage+count);
+        if(rc==RC_OK)
+            rc=transferBlocks(fHandle,startPage,count,memPages,1);
+        if(rc==RC_OK && (info->flags&SM_OPEN_MMAP))
+            rc=growMap(info,startPage+count);
+        if(rc==RC_OK)
+            growTotal(fHandle,startPage+count);
+        pthread_rwlock_unlock(&info->growLatch);
+    }
+    free(copies);
+    free(sealed);
+    dropWindow(info,startPage,count);
+    if(rc!=RC_OK)
+        return rc;
+    //pages written behind the old end count as appended
+    if(startPage+count<=total)
+        countIO(info,&info->ioStats.write,startPage,count,(long)count*info->pageSize,start);
+    else
+        countIO(info,&info->ioStats.append,startPage,count,(long)(startPage+count-total)*info->pageSize,start);
+    __atomic_store_n(&fHandle->curPagePos,startPage+count-1,__ATOMIC_RELAXED);
     return RC_OK;
 }
 
 /****************************************************************
- *Function Name: openPageFile
+ *Function Name: appendEmptyBlock
  *
- * Description: Open an existing page file and initialize file handle
+ * Description: add new block
  *
  * Parameter:
- *        char *fileName
  *        SM_FileHandle *fHandle
  *
  * Return:
  *     RC: returned code
  ***************************************************************/
-RC openPageFile(char *fileName, SM_FileHandle *fHandle){
-    FILE *fp;
-    int size;
-    //Open an existing file in read mode
-    fp=fopen(fileName,"rb+");
-    if(fp==NULL){
+RC appendEmptyBlock(SM_FileHandle *fHandle){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    RC rc;
+    if(info==NULL){
         printf("unable to open file");
-        //return error if file does not exist
         return RC_FILE_NOT_FOUND;
     }
-    //Initialize file handle field
-    fHandle->fileName =fileName;
-    fHandle->curPagePos=0;
-    fseek(fp, 0L, SEEK_END);
-    size=ftell(fp);
-    
-    fHandle->totalNumPages=size/PAGE_SIZE;
-    fseek(fp, 0, SEEK_SET);
-    fHandle->mgmtInfo=fp;
-    return RC_OK;
+    //append new page of zero bytes, it becomes the current page
+    pthread_rwlock_wrlock(&info->growLatch);
+    rc=growFile(fHandle,__atomic_load_n(&fHandle->totalNumPages,__ATOMIC_RELAXED)+1);
+    pthread_rwlock_unlock(&info->growLatch);
+    return rc;
 }
 
 
 /****************************************************************
- *Function Name: closePageFile
+ *Function Name: ensureCapacity
  *
- * Description: Close an open page file
+ * Description: If file has less number of pages append additional
+ *              pages. Disk blocks are reserved in whole extents and the
+ *              file is extended with one ftruncate, new pages read as zero
  *
  * Parameter:
- *       SM_FileHandle *fHandle
+ *        PageNumber numberOfPages
+ *        SM_FileHandle *fHandle
  *
  * Return:
  *     RC: returned code
  ***************************************************************/
-RC closePageFile(SM_FileHandle *fHandle){
-    //close opened page file
-    fclose(fHandle->mgmtInfo);
-    return RC_OK;
-    
+RC ensureCapacity(PageNumber numberOfPages, SM_FileHandle *fHandle){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    RC rc;
+    if(info==NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    pthread_rwlock_wrlock(&info->growLatch);
+    rc=growFile(fHandle,numberOfPages);
+    pthread_rwlock_unlock(&info->growLatch);
+    return rc;
 }
 
 /****************************************************************
- *Function Name: destroyPageFile
+ *Function Name: setExtentSize
  *
- * Description: Delete page file
+ * Description: Set number of pages reserved at once when the file grows
  *
  * Parameter:
- *       char *fileName
+ *        SM_FileHandle *fHandle
+ *        int numPages
  *
  * Return:
  *     RC: returned code
  ***************************************************************/
-RC destroyPageFile(char *fileName){
-    remove(fileName);
+RC setExtentSize(SM_FileHandle *fHandle, int numPages){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    if(info==NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    pthread_rwlock_wrlock(&info->growLatch);
+    info->extentPages= numPages>0 ? numPages : 1;
+    pthread_rwlock_unlock(&info->growLatch);
     return RC_OK;
 }
 
 /****************************************************************
- *Function Name: readBlock
+ *Function Name: setReadahead
  *
- * Description: Read pageNumth block
+ * Description: Set number of pages readBlock reads ahead once it sees
+ *              a run, at most SM_MAX_READAHEAD. 0 turns readahead off
  *
  * Parameter:
- *        int pageNum
  *        SM_FileHandle *fHandle
- *        SM_PageHandle memPage
+ *        int numPages
  *
  * Return:
  *     RC: returned code
  ***************************************************************/
-RC readBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage){
-    //check if pageNum is greater than totalNumPages
-    if(pageNum> fHandle->totalNumPages){
-        //return error if pageNum is greater
-        return RC_READ_NON_EXISTING_PAGE;
-    }
-    //move file pointer to appropriate position
-    fseek(fHandle->mgmtInfo, pageNum*PAGE_SIZE, SEEK_SET);
-    //reads a block of size PAGE_SIZE
-    fread((void*)memPage, PAGE_SIZE, 1,fHandle->mgmtInfo);
-    //Update curPagePos to pageNum+1
-    fHandle->curPagePos=pageNum+1;
+RC setReadahead(SM_FileHandle *fHandle, int numPages){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    if(info==NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    pthread_mutex_lock(&info->raLatch);
+    free(info->raBuf);
+    free(info->raSpare);
+    info->raBuf=NULL;
+    info->raSpare=NULL;
+    info->raCount=0;
+    //a fill running now has the old size, it is dropped
+    info->raStale=1;
+    __atomic_store_n(&info->raPages,numPages<0 ? 0 : numPages>SM_MAX_READAHEAD ? SM_MAX_READAHEAD : numPages,__ATOMIC_RELAXED);
+    pthread_mutex_unlock(&info->raLatch);
     return RC_OK;
-    
 }
 
+/****************************************************************
+ *Function Name: storeFreeList
+ *
+ * Description: Write chain of free pages of info to the header of the
+ *              file, or of the page map of a compressed file. The caller
+ *              holds the free latch
+ *
+ * Parameter:
+ *        SM_FileInfo *info
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+static RC storeFreeList(SM_FileInfo *info){
+    SM_FileHeader header;
+    newHeader(&header,info->pageSize);
+    header.freePages=info->freePages;
+    header.freeHead=info->freeHead;
+    //the names of the members of a tablespace follow its header
+    header.stripes=info->stripes;
+    if(info->stripes>0)
+        return writeFull(info->fd,(char*)&header,sizeof(header),0);
+    if(info->pageMapFd>=0)
+        return writeHeader(info->pageMapFd,&header,SM_MAP_HEADER_SIZE);
+    return writeHeader(info->fd,&header,SM_HEADER_SIZE);
+}
 
 /****************************************************************
- *Function Name: getBlockPos
+ *Function Name: freeRecord
+ *
+ * Description: Returns the following page of the chain if page holds
+ *              a free page record, else -1
  *
- * Description: Return current page position
+ * Parameter:
+ *        const char *page
+ *
+ * Return:
+ *     PageNumber
+ ***************************************************************/
+static PageNumber freeRecord(const char *page){
+    SM_FreeRecord record;
+    memcpy(&record,page,sizeof(record));
+    if(memcmp(record.magic,SM_FREE_MAGIC,sizeof(record.magic))!=0 || record.next>INT64_MAX)
+        return -1;
+    return (PageNumber)record.next;
+}
+
+/****************************************************************
+ *Function Name: allocatePage
+ *
+ * Description: Hand out a page for new data: the page freed last if
+ *              the chain of free pages is not empty, else a new page
+ *              appended to the file, so files with churn reuse their
+ *              space instead of growing. The page reads as zero and
+ *              becomes the current page. Files without header have no
+ *              chain and always grow
  *
  * Parameter:
  *        SM_FileHandle *fHandle
+ *        PageNumber *pageNum: page handed out
  *
  * Return:
- *       int
+ *     RC: returned code, RC_FREE_LIST_DAMAGED if the chain is broken
  ***************************************************************/
-int getBlockPos(SM_FileHandle *fHandle){
-    return fHandle->curPagePos;
+RC allocatePage(SM_FileHandle *fHandle, PageNumber *pageNum){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    char *page;
+    PageNumber next,total;
+    RC rc;
+    if(info==NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if(posix_memalign((void**)&page,SM_DIRECT_ALIGN,info->pageSize)!=0)
+        return RC_WRITE_FAILED;
+    pthread_mutex_lock(&info->freeLatch);
+    if(info->freePages==0){
+        pthread_rwlock_wrlock(&info->growLatch);
+        total=__atomic_load_n(&fHandle->totalNumPages,__ATOMIC_RELAXED);
+        rc=growFile(fHandle,total+1);
+        pthread_rwlock_unlock(&info->growLatch);
+        if(rc==RC_OK)
+            *pageNum=total;
+    }
+    else{
+        total=__atomic_load_n(&fHandle->totalNumPages,__ATOMIC_RELAXED);
+        rc=RC_FREE_LIST_DAMAGED;
+        next=-1;
+        if(info->freeHead>=0 && info->freeHead<total){
+            rc=readPage(info->freeHead,fHandle,page);
+            //a record written while checksums were off does not match, its link is checked anyway
+            if(rc==RC_OK || rc==RC_CHECKSUM_MISMATCH){
+                next=freeRecord(page);
+                rc=RC_FREE_LIST_DAMAGED;
+            }
+        }
+        if(next>=0 && (info->freePages==1 || next<total)){
+            *pageNum=info->freeHead;
+            //header first, a crash leaks the page instead of handing it out twice
+            info->freeHead=next;
+            info->freePages--;
+            rc=storeFreeList(info);
+            if(rc!=RC_OK){
+                info->freeHead=*pageNum;
+                info->freePages++;
+            }
+            memset(page,0,info->pageSize);
+            if(rc==RC_OK)
+                rc=writePage(*pageNum,fHandle,page);
+            if(rc==RC_OK)
+                __atomic_store_n(&fHandle->curPagePos,*pageNum,__ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&info->freeLatch);
+    free(page);
+    return rc;
 }
 
+/****************************************************************
+ *Function Name: freePage
+ *
+ * Description: Give page pageNum back for reuse by allocatePage. A free
+ *              page record linking to the previous head of the chain is
+ *              written to the page, then the header points to it. Freeing
+ *              a page twice is detected by its record. The page keeps its
+ *              place in the file, totalNumPages does not change
+ *
+ * Parameter:
+ *        PageNumber pageNum
+ *        SM_FileHandle *fHandle
+ *
+ * Return:
+ *     RC: returned code, RC_PAGE_NOT_ALLOCATED if the page is free already
+ ***************************************************************/
+RC freePage(PageNumber pageNum, SM_FileHandle *fHandle){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    SM_FreeRecord record;
+    char *page;
+    RC rc;
+    if(info==NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    //the chain lives in the header
+    if(info->dataOffset==0 && info->pageMapFd<0 && info->stripes==0)
+        return RC_NO_FILE_HEADER;
+    if(pageNum<0 || pageNum>=__atomic_load_n(&fHandle->totalNumPages,__ATOMIC_RELAXED))
+        return RC_READ_NON_EXISTING_PAGE;
+    if(posix_memalign((void**)&page,SM_DIRECT_ALIGN,info->pageSize)!=0)
+        return RC_WRITE_FAILED;
+    pthread_mutex_lock(&info->freeLatch);
+    rc=readPage(pageNum,fHandle,page);
+    if((rc==RC_OK || rc==RC_CHECKSUM_MISMATCH) && freeRecord(page)>=0)
+        rc=RC_PAGE_NOT_ALLOCATED;
+    else{
+        memset(page,0,info->pageSize);
+        memset(&record,0,sizeof(record));
+        memcpy(record.magic,SM_FREE_MAGIC,sizeof(record.magic));
+        record.next= info->freePages>0 ? info->freeHead : 0;
+        memcpy(page,&record,sizeof(record));
+        //record first, the header never points to a page in use
+        rc=writePage(pageNum,fHandle,page);
+        if(rc==RC_OK){
+            info->freeHead=pageNum;
+            info->freePages++;
+            rc=storeFreeList(info);
+            if(rc!=RC_OK){
+                info->freeHead=record.next;
+                info->freePages--;
+            }
+        }
+    }
+    pthread_mutex_unlock(&info->freeLatch);
+    free(page);
+    return rc;
+}
 
 /****************************************************************
- *Function Name: readFirstBlock
+ *Function Name: getFreePageCount
  *
- * Description: Read first block
+ * Description: Returns number of pages on the chain of free pages
  *
  * Parameter:
  *        SM_FileHandle *fHandle
- *        SM_PageHandle memPage
  *
  * Return:
- *     RC: returned code
+ *     PageNumber
  ***************************************************************/
-RC readFirstBlock(SM_FileHandle *fHandle, SM_PageHandle memPage){
-    //Move file pointer to first block
-    fseek(fHandle->mgmtInfo, 0, SEEK_SET);
-    //read first block
-    fread((void*)memPage, PAGE_SIZE, 1,fHandle->mgmtInfo);
-    //update current page position
-    fHandle->curPagePos=1;
-    return RC_OK;
-    
+PageNumber getFreePageCount(SM_FileHandle *fHandle){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    PageNumber n;
+    if(info==NULL)
+        return 0;
+    pthread_mutex_lock(&info->freeLatch);
+    n=info->freePages;
+    pthread_mutex_unlock(&info->freeLatch);
+    return n;
 }
 
+/****************************************************************
+ *Function Name: syncFiles
+ *
+ * Description: fdatasync the files holding the pages of info: the page
+ *              file, the page map of a compressed file and the members
+ *              of a tablespace. A mapping is written back with msync
+ *              first
+ *
+ * Parameter:
+ *        SM_FileInfo *info
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+static RC syncFiles(SM_FileInfo *info){
+    RC rc=RC_OK;
+    int i;
+    long start=ioClock();
+    if(info->map!=NULL){
+        pthread_rwlock_rdlock(&info->growLatch);
+        if(msync(info->map,info->mapSize,MS_SYNC)!=0)
+            rc=RC_WRITE_FAILED;
+        pthread_rwlock_unlock(&info->growLatch);
+    }
+    for(i=0;i<info->stripes;i++){
+        if(fdatasync(info->stripeFd[i])!=0)
+            rc=RC_WRITE_FAILED;
+    }
+    if(info->pageMapFd>=0 && fdatasync(info->pageMapFd)!=0)
+        rc=RC_WRITE_FAILED;
+    if(fdatasync(info->fd)!=0)
+        rc=RC_WRITE_FAILED;
+    if(rc==RC_OK)
+        countIO(info,&info->ioStats.sync,-1,0,0,start);
+    return rc;
+}
 
 /****************************************************************
- *Function Name: readPreviousBlock
+ *Function Name: setDurability
  *
- * Description: Read previous block
+ * Description: Set what syncPageFile does: SM_DURABILITY_NONE nothing,
+ *              SM_DURABILITY_SYNC one fdatasync per call,
+ *              SM_DURABILITY_GROUP one fdatasync for the calls of all
+ *              threads within SM_GROUP_COMMIT_USEC
  *
  * Parameter:
  *        SM_FileHandle *fHandle
- *        SM_PageHandle memPage
+ *        int level
  *
  * Return:
  *     RC: returned code
  ***************************************************************/
-RC readPreviousBlock(SM_FileHandle *fHandle, SM_PageHandle memPage){
-    //check if current page position is a valid position
-    if((fHandle->curPagePos-1)<0 )
-        return RC_READ_NON_EXISTING_PAGE;
-    //move file pointer to previous block position
-    fseek(fHandle->mgmtInfo, (fHandle->curPagePos-1)*PAGE_SIZE, SEEK_SET);
-    //read previous block
-    fread((void*)memPage, PAGE_SIZE, 1,fHandle->mgmtInfo);
-    fseek(fHandle->mgmtInfo, -1*PAGE_SIZE, SEEK_CUR);
-    //decrease current page position by 1
-    fHandle->curPagePos=fHandle->curPagePos-1;
+RC setDurability(SM_FileHandle *fHandle, int level){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    if(info==NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if(level<SM_DURABILITY_NONE || level>SM_DURABILITY_GROUP)
+        return RC_BAD_DURABILITY;
+    __atomic_store_n(&info->durability,level,__ATOMIC_RELAXED);
     return RC_OK;
-    
 }
 
 /****************************************************************
- *Function Name: readCurrentBlock
+ *Function Name: syncPageFile
  *
- * Description: Read current block
+ * Description: Make the pages written to the file so far durable, as
+ *              the durability level of the file asks. With group commit
+ *              every call takes a ticket. If no sync is running the
+ *              caller leads one for all tickets taken until it starts.
+ *              If the last sync covered several calls, the leader first
+ *              waits SM_GROUP_COMMIT_USEC for more to join; a caller
+ *              alone never waits. Other callers wait until a sync
+ *              covering their ticket is done, leading the next one if
+ *              the running sync started before they came
  *
  * Parameter:
  *        SM_FileHandle *fHandle
- *        SM_PageHandle memPage
  *
  * Return:
- *     RC: returned code
+ *     RC: returned code, RC_WRITE_FAILED if the sync failed
  ***************************************************************/
-RC readCurrentBlock(SM_FileHandle *fHandle, SM_PageHandle memPage){
-    //move file pointer to current block position
-    fseek(fHandle->mgmtInfo, 0, SEEK_CUR);
-    //read current block
-    fread((void*)memPage, PAGE_SIZE, 1,fHandle->mgmtInfo);
-    fseek(fHandle->mgmtInfo, -1*PAGE_SIZE, SEEK_CUR);
-    //Update current page position
-    fHandle->curPagePos=fHandle->curPagePos;
-    return RC_OK;
-    
+RC syncPageFile(SM_FileHandle *fHandle){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    struct timespec window={0,SM_GROUP_COMMIT_USEC*1000L};
+    long ticket,target;
+    RC rc=RC_OK;
+    if(info==NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    switch(__atomic_load_n(&info->durability,__ATOMIC_RELAXED)){
+    case SM_DURABILITY_NONE:
+        return RC_OK;
+    case SM_DURABILITY_SYNC:
+        return syncFiles(info);
+    }
+    pthread_mutex_lock(&info->syncLatch);
+    ticket=++info->syncTickets;
+    while(info->syncedTicket<ticket && info->failedTicket<ticket){
+        if(info->syncing){
+            pthread_cond_wait(&info->syncDone,&info->syncLatch);
+            continue;
+        }
+        info->syncing=1;
+        if(info->syncGroup>1){
+            pthread_mutex_unlock(&info->syncLatch);
+            nanosleep(&window,NULL);
+            pthread_mutex_lock(&info->syncLatch);
+        }
+        //every ticket taken so far was taken after its writes
+        target=info->syncTickets;
+        info->syncGroup=target-info->syncedTicket;
+        pthread_mutex_unlock(&info->syncLatch);
+        rc=syncFiles(info);
+        pthread_mutex_lock(&info->syncLatch);
+        if(rc==RC_OK)
+            info->syncedTicket=target;
+        else
+            info->failedTicket=target;
+        info->syncing=0;
+        pthread_cond_broadcast(&info->syncDone);
+    }
+    //a later sync may have covered the ticket after a failed one
+    if(info->syncedTicket<ticket)
+        rc=RC_WRITE_FAILED;
+    else
+        rc=RC_OK;
+    pthread_mutex_unlock(&info->syncLatch);
+    return rc;
 }
 
 /****************************************************************
- *Function Name: readNextBlock
+ *Function Name: getFileIOStats
  *
- * Description: Read Next block
+ * Description: Copy the I/O counters of the file to stats. Counters
+ *              are read one by one while other threads go on, so they
+ *              are not a snapshot of a single moment
  *
  * Parameter:
  *        SM_FileHandle *fHandle
- *        SM_PageHandle memPage
+ *        SM_IOStats *stats
  *
  * Return:
  *     RC: returned code
  ***************************************************************/
-RC readNextBlock(SM_FileHandle *fHandle, SM_PageHandle memPage){
-    //check if current page position is greater than total num pages
-    if(fHandle->curPagePos>fHandle->totalNumPages)
-        return RC_READ_NON_EXISTING_PAGE;//return error if curpagePos is greater
-    //Move file pointer to next block position
-    fseek(fHandle->mgmtInfo, (fHandle->curPagePos+1)*PAGE_SIZE, SEEK_SET);
-    //read next block
-    fread((void*)memPage, PAGE_SIZE, 1,fHandle->mgmtInfo);
-    fseek(fHandle->mgmtInfo, (fHandle->curPagePos+1)*PAGE_SIZE, SEEK_SET);
-    //increase the current page position by 1
-    fHandle->curPagePos=fHandle->curPagePos+1;
+RC getFileIOStats(SM_FileHandle *fHandle, SM_IOStats *stats){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    long *from,*to;
+    size_t i;
+    if(info==NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    //SM_IOStats holds longs only
+    from=(long*)&info->ioStats;
+    to=(long*)stats;
+    for(i=0;i<sizeof(SM_IOStats)/sizeof(long);i++)
+        to[i]=__atomic_load_n(&from[i],__ATOMIC_RELAXED);
     return RC_OK;
-    
 }
 
+/****************************************************************
+ *Function Name: setupRing
+ *
+ * Description: Create io_uring instance of queue with raw system calls
+ *              and map its rings
+ *
+ * Parameter:
+ *        SM_IOQueue *queue
+ *        int depth
+ *
+ * Return:
+ *     int: ring file descriptor or -1 if io_uring is not available
+ ***************************************************************/
+static int setupRing(SM_IOQueue *queue, int depth){
+    struct io_uring_params params;
+    char *sq,*cq;
+    int fd;
+    memset(&params,0,sizeof(params));
+    fd=(int)syscall(__NR_io_uring_setup,depth,&params);
+    if(fd<0)
+        return -1;
+    queue->sqRingSize=params.sq_off.array+params.sq_entries*sizeof(unsigned);
+    queue->cqRingSize=params.cq_off.cqes+params.cq_entries*sizeof(struct io_uring_cqe);
+    //newer kernels map both rings at once
+    if(params.features&IORING_FEAT_SINGLE_MMAP){
+        if(queue->cqRingSize>queue->sqRingSize)
+            queue->sqRingSize=queue->cqRingSize;
+        queue->cqRingSize=queue->sqRingSize;
+    }
+    queue->sqRing=mmap(NULL,queue->sqRingSize,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,fd,IORING_OFF_SQ_RING);
+    if(queue->sqRing==MAP_FAILED){
+        close(fd);
+        return -1;
+    }
+    if(params.features&IORING_FEAT_SINGLE_MMAP)
+        queue->cqRing=queue->sqRing;
+    else
+        queue->cqRing=mmap(NULL,queue->cqRingSize,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,fd,IORING_OFF_CQ_RING);
+    queue->sqesSize=params.sq_entries*sizeof(struct io_uring_sqe);
+    queue->sqes= queue->cqRing==MAP_FAILED ? MAP_FAILED : mmap(NULL,queue->sqesSize,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,fd,IORING_OFF_SQES);
+    if(queue->sqes==MAP_FAILED){
+        if(queue->cqRing!=MAP_FAILED && queue->cqRing!=queue->sqRing)
+            munmap(queue->cqRing,queue->cqRingSize);
+        munmap(queue->sqRing,queue->sqRingSize);
+        close(fd);
+        return -1;
+    }
+    sq=(char*)queue->sqRing;
+    cq=(char*)queue->cqRing;
+    queue->sqTail=(unsigned*)(sq+params.sq_off.tail);
+    queue->sqMask=(unsigned*)(sq+params.sq_off.ring_mask);
+    queue->sqArray=(unsigned*)(sq+params.sq_off.array);
+    queue->sqEntries=params.sq_entries;
+    queue->cqHead=(unsigned*)(cq+params.cq_off.head);
+    queue->cqTail=(unsigned*)(cq+params.cq_off.tail);
+    queue->cqMask=(unsigned*)(cq+params.cq_off.ring_mask);
+    queue->cqes=(struct io_uring_cqe*)(cq+params.cq_off.cqes);
+    return fd;
+}
 
 /****************************************************************
- *Function Name: readLastBlock
+ *Function Name: initIOQueue
  *
- * Description: Read last block
+ * Description: Create queue keeping up to depth page I/Os in flight
+ *              (SM_IO_DEPTH if depth is 0). Uses io_uring; if the
+ *              system does not provide it, I/Os are done synchronously
+ *              when they are submitted and only reported by
+ *              pollCompletions. A queue may serve several files
  *
  * Parameter:
- *        SM_FileHandle *fHandle
- *        SM_PageHandle memPage
+ *        SM_IOQueue **queue
+ *        int depth
  *
  * Return:
  *     RC: returned code
  ***************************************************************/
-RC readLastBlock(SM_FileHandle *fHandle, SM_PageHandle memPage){
-    //Move file pointer to last block position
-    fseek(fHandle->mgmtInfo, -1*PAGE_SIZE, SEEK_END);
-    //read last block
-    fread((void*)memPage, PAGE_SIZE, 1,fHandle->mgmtInfo);
-    //update current page position
-    fHandle->curPagePos=fHandle->totalNumPages;
+RC initIOQueue(SM_IOQueue **queue, int depth){
+    SM_IOQueue *q;
+    int i;
+    if(depth<=0)
+        depth=SM_IO_DEPTH;
+    q=(SM_IOQueue*)calloc(1,sizeof(SM_IOQueue));
+    q->requests=(SM_IORequest*)malloc(sizeof(SM_IORequest)*depth);
+    //chain free requests
+    for(i=0;i<depth;i++)
+        q->requests[i].next= i+1<depth ? i+1 : -1;
+    q->freeRequest=0;
+    q->doneFirst=-1;
+    q->doneLast=-1;
+    q->ringFd=setupRing(q,depth);
+    *queue=q;
     return RC_OK;
-    
 }
 
 /****************************************************************
- *Function Name: writeBlock
+ *Function Name: shutdownIOQueue
  *
- * Description: write pageNumth block
+ * Description: Wait for I/Os still in flight and free the queue.
+ *              Completions not polled yet are dropped
  *
  * Parameter:
- *        int pageNum
- *        SM_FileHandle *fHandle
- *        SM_PageHandle memPage
+ *        SM_IOQueue *queue
  *
  * Return:
  *     RC: returned code
  ***************************************************************/
-RC writeBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage){
-    //check if pageNum is greater than totalNumPages
-    if(pageNum>fHandle->totalNumPages){
-        appendEmptyBlock(fHandle);//return error if pageNum is greater
+RC shutdownIOQueue(SM_IOQueue *queue){
+    SM_IOCompletion done;
+    //the kernel may still write into the buffers
+    while(queue->inFlight>0)
+        pollCompletions(queue,&done,1,1);
+    if(queue->ringFd>=0){
+        munmap(queue->sqes,queue->sqesSize);
+        if(queue->cqRing!=queue->sqRing)
+            munmap(queue->cqRing,queue->cqRingSize);
+        munmap(queue->sqRing,queue->sqRingSize);
+        close(queue->ringFd);
     }
-    //Move file pointer to appropriate position
-    fseek(fHandle->mgmtInfo, pageNum*PAGE_SIZE, SEEK_SET);
-    fwrite((void*)memPage, PAGE_SIZE, 1,fHandle->mgmtInfo);
-    //Update current page position to pageNum+1
-    fHandle->curPagePos=pageNum+1;
+    free(queue->requests);
+    free(queue);
     return RC_OK;
 }
 
+/****************************************************************
+ *Function Name: enterRing / reapRing
+ *
+ * Description: enterRing hands queued requests to the kernel and waits
+ *              for minComplete completions; reapRing moves completed
+ *              requests from the completion ring to the done list
+ *
+ * Parameter:
+ *        SM_IOQueue *queue
+ *        int minComplete
+ *
+ * Return:
+ *     void
+ ***************************************************************/
+static void enterRing(SM_IOQueue *queue, int minComplete){
+    int ret;
+    do{
+        ret=(int)syscall(__NR_io_uring_enter,queue->ringFd,queue->toSubmit,minComplete,minComplete>0 ? IORING_ENTER_GETEVENTS : 0,NULL,0);
+    }while(ret<0 && errno==EINTR);
+    if(ret>0)
+        queue->toSubmit-=ret;
+}
+
+static void doneRequest(SM_IOQueue *queue, int idx){
+    queue->requests[idx].next=-1;
+    if(queue->doneLast==-1)
+        queue->doneFirst=idx;
+    else
+        queue->requests[queue->doneLast].next=idx;
+    queue->doneLast=idx;
+}
+
+static void reapRing(SM_IOQueue *queue){
+    unsigned head=*queue->cqHead;
+    unsigned tail=__atomic_load_n(queue->cqTail,__ATOMIC_ACQUIRE);
+    struct io_uring_cqe *cqe;
+    SM_IORequest *req;
+    while(head!=tail){
+        cqe=&queue->cqes[head&*queue->cqMask];
+        req=&queue->requests[cqe->user_data];
+        //iov_len is the page size of the file of the request
+        if(cqe->res<0 || (req->write && cqe->res<(int)req->iov.iov_len))
+            req->rc= req->write ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+        else{
+            //end of file, the rest of the page is empty
+            if(cqe->res<(int)req->iov.iov_len)
+                memset((char*)req->iov.iov_base+cqe->res,0,req->iov.iov_len-cqe->res);
+            req->rc= req->check ? checkPage(req->iov.iov_base,(int)req->iov.iov_len) : RC_OK;
+        }
+        if(req->write)
+            dropWindow(req->info,req->pageNum,1);
+        free(req->sealBuf);
+        req->sealBuf=NULL;
+        if(req->rc==RC_OK || req->rc==RC_CHECKSUM_MISMATCH)
+            countIO(req->info,req->write ? &req->info->ioStats.write : &req->info->ioStats.read,req->pageNum,1,req->iov.iov_len,req->start);
+        doneRequest(queue,(int)cqe->user_data);
+        queue->inFlight--;
+        head++;
+    }
+    __atomic_store_n(queue->cqHead,head,__ATOMIC_RELEASE);
+}
 
 /****************************************************************
- *Function Name: writeCurrentBlock
+ *Function Name: submitPage
  *
- * Description: write current block
+ * Description: Queue read or write of page pageNum. Requests are
+ *              handed to the kernel in batches by pollCompletions, or
+ *              when the submission ring is full. Mapped and compressed
+ *              files and writes behind the end of the file are done
+ *              synchronously
  *
  * Parameter:
+ *        SM_IOQueue *queue
+ *        PageNumber pageNum
  *        SM_FileHandle *fHandle
  *        SM_PageHandle memPage
+ *        void *userData
+ *        int write
  *
  * Return:
  *     RC: returned code
  ***************************************************************/
-RC writeCurrentBlock(SM_FileHandle *fHandle, SM_PageHandle memPage){
-    //Move file pointer to current block position
-    fseek(fHandle->mgmtInfo, 0, SEEK_CUR);
-    fwrite((void*)memPage, PAGE_SIZE, 1,fHandle->mgmtInfo);
-    fseek(fHandle->mgmtInfo, -1*PAGE_SIZE, SEEK_CUR);
-    //update current Page position
-    fHandle->curPagePos=fHandle->curPagePos;
+static RC submitPage(SM_IOQueue *queue, PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, void *userData, int write){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    SM_IORequest *req;
+    struct io_uring_sqe *sqe;
+    unsigned tail,index;
+    off_t offset;
+    PageNumber total;
+    int idx,fd;
+    total=__atomic_load_n(&fHandle->totalNumPages,__ATOMIC_RELAXED);
+    if(pageNum<0 || (!write && pageNum>=total))
+        return write ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+    if((info->flags&SM_OPEN_DIRECT) && !(info->flags&SM_OPEN_MMAP) && (uintptr_t)memPage%SM_DIRECT_ALIGN!=0)
+        return RC_BAD_ALIGNMENT;
+    if(queue->freeRequest==-1)
+        return RC_IO_QUEUE_FULL;
+    idx=queue->freeRequest;
+    req=&queue->requests[idx];
+    queue->freeRequest=req->next;
+    req->userData=userData;
+    req->write=write;
+    req->iov.iov_base=memPage;
+    req->iov.iov_len=info->pageSize;
+    req->check=!write && (info->flags&SM_OPEN_CHECKSUM);
+    req->info=info;
+    req->pageNum=pageNum;
+    req->start=ioClock();
+    req->sealBuf=NULL;
+    if(queue->ringFd<0 || (info->flags&SM_OPEN_MMAP) || info->pageMapFd>=0 || pageNum>=total){
+        req->rc= write ? writePage(pageNum,fHandle,memPage) : readPage(pageNum,fHandle,memPage);
+        doneRequest(queue,idx);
+        return RC_OK;
+    }
+    if(write && (info->flags&SM_OPEN_CHECKSUM)){
+        req->sealBuf=sealCopies(info,&memPage,1,&memPage);
+        if(req->sealBuf==NULL){
+            req->next=queue->freeRequest;
+            queue->freeRequest=idx;
+            return RC_WRITE_FAILED;
+        }
+        req->iov.iov_base=memPage;
+    }
+    fd=locatePage(fHandle,pageNum,&offset);
+    tail=*queue->sqTail;
+    index=tail&*queue->sqMask;
+    sqe=&queue->sqes[index];
+    memset(sqe,0,sizeof(*sqe));
+    sqe->opcode= write ? IORING_OP_WRITEV : IORING_OP_READV;
+    sqe->fd=fd;
+    sqe->off=offset;
+    sqe->addr=(unsigned long)&req->iov;
+    sqe->len=1;
+    sqe->user_data=idx;
+    queue->sqArray[index]=index;
+    __atomic_store_n(queue->sqTail,tail+1,__ATOMIC_RELEASE);
+    queue->toSubmit++;
+    queue->inFlight++;
+    if(queue->toSubmit==(int)queue->sqEntries)
+        enterRing(queue,0);
     return RC_OK;
-    
 }
 
 /****************************************************************
- *Function Name: appendEmptyBlock
+ *Function Name: submitRead / submitWrite
  *
- * Description: add new block
+ * Description: Queue read of page pageNum into memPage / write of
+ *              memPage to page pageNum. memPage must stay valid until
+ *              the completion with userData is polled. Returns
+ *              RC_IO_QUEUE_FULL if depth I/Os are not polled yet.
+ *              Asynchronous I/O does not move the current page position
  *
  * Parameter:
+ *        SM_IOQueue *queue
+ *        PageNumber pageNum
  *        SM_FileHandle *fHandle
+ *        SM_PageHandle memPage
+ *        void *userData
  *
  * Return:
  *     RC: returned code
  ***************************************************************/
-RC appendEmptyBlock(SM_FileHandle *fHandle){
-    
-    if(fHandle->mgmtInfo==NULL){
-        printf("unable to open file");
-        return RC_FILE_NOT_FOUND;
+RC submitRead(SM_IOQueue *queue, PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, void *userData){
+    return submitPage(queue,pageNum,fHandle,memPage,userData,0);
+}
+
+RC submitWrite(SM_IOQueue *queue, PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, void *userData){
+    return submitPage(queue,pageNum,fHandle,memPage,userData,1);
+}
+
+/****************************************************************
+ *Function Name: pollCompletions
+ *
+ * Description: Start queued I/Os, wait until at least minWait of the
+ *              submitted I/Os are complete (fewer if fewer are
+ *              outstanding) and return up to max completions
+ *
+ * Parameter:
+ *        SM_IOQueue *queue
+ *        SM_IOCompletion *done
+ *        int max
+ *        int minWait
+ *
+ * Return:
+ *     int: completions stored in done
+ ***************************************************************/
+int pollCompletions(SM_IOQueue *queue, SM_IOCompletion *done, int max, int minWait){
+    SM_IORequest *req;
+    int n=0,want,numDone=0,idx;
+    if(queue->ringFd>=0){
+        reapRing(queue);
+        for(idx=queue->doneFirst;idx!=-1;idx=queue->requests[idx].next)
+            numDone++;
+        want= minWait-numDone<queue->inFlight ? minWait-numDone : queue->inFlight;
+        if(queue->toSubmit>0 || want>0){
+            enterRing(queue,want>0 ? want : 0);
+            reapRing(queue);
+        }
     }
-    char *newPage;
-    //allocate a block of memory and set it to zero
-    newPage = (char *) calloc(PAGE_SIZE, sizeof(char));
-    int i;
-    //move file pointer to end of file
-    fseek(fHandle->mgmtInfo,0L,2);
-    //append new page of zero bytes
-    for(i=0;i<PAGE_SIZE;i++){
-        fwrite(newPage,sizeof(char),1,fHandle->mgmtInfo);
-        fseek(fHandle->mgmtInfo,0L,2);
-    }
-    int size;
-    //update file handle field
-    size=ftell(fHandle->mgmtInfo);
-    
-    fHandle->totalNumPages=size/PAGE_SIZE;
-    //fseek(fHandle->mgmtInfo, 0, SEEK_SET);
-    fHandle->curPagePos = fHandle->totalNumPages - 1;
-    //printf("Cur pages:%d", fHandle->curPagePos);
-    //free allocated memory
-    free(newPage);
-    return RC_OK;
-    
+    while(n<max && queue->doneFirst!=-1){
+        idx=queue->doneFirst;
+        req=&queue->requests[idx];
+        queue->doneFirst=req->next;
+        if(queue->doneFirst==-1)
+            queue->doneLast=-1;
+        done[n].userData=req->userData;
+        done[n].rc=req->rc;
+        req->next=queue->freeRequest;
+        queue->freeRequest=idx;
+        n++;
+    }
+    return n;
 }
 
+/****************************************************************
+ *Function Name: scrubMain
+ *
+ * Description: Scrubber of a file opened with SM_OPEN_CHECKSUM. Reads
+ *              the pages in file order, SM_SCRUB_BATCH at a time, and
+ *              pauses after each batch so no more than scrubRate pages
+ *              are read per second. Starts over at page 0 after the last
+ *              page. A page failing verification is read once more,
+ *              since a write of the page may have been in progress
+ *
+ * Parameter:
+ *        void *arg: SM_FileHandle
+ *
+ * Return:
+ *    void*
+ ***************************************************************/
+static void *scrubMain(void *arg){
+    SM_FileHandle *fHandle=(SM_FileHandle*)arg;
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    struct timespec until,now;
+    char *page;
+    long pause;
+    PageNumber pageNum=0,lastCorrupt;
+    int i,checked,corrupt,passes;
+    if(posix_memalign((void**)&page,SM_DIRECT_ALIGN,info->pageSize)!=0)
+        return NULL;
+    clock_gettime(CLOCK_REALTIME,&until);
+    pthread_mutex_lock(&info->scrubLatch);
+    while(!info->scrubStop){
+        pthread_mutex_unlock(&info->scrubLatch);
+        checked=0;
+        corrupt=0;
+        lastCorrupt=-1;
+        passes=0;
+        for(i=0;i<SM_SCRUB_BATCH;i++){
+            if(pageNum>=__atomic_load_n(&fHandle->totalNumPages,__ATOMIC_RELAXED)){
+                //an empty file is not a pass
+                if(pageNum>0)
+                    passes++;
+                pageNum=0;
+                if(__atomic_load_n(&fHandle->totalNumPages,__ATOMIC_RELAXED)==0)
+                    break;
+            }
+            //scrubber reads do not distort the statistics of the foreground reads
+            if(readPageAs(pageNum,fHandle,page,&info->ioStats.scrub)==RC_CHECKSUM_MISMATCH && readPageAs(pageNum,fHandle,page,&info->ioStats.scrub)==RC_CHECKSUM_MISMATCH){
+                corrupt++;
+                lastCorrupt=pageNum;
+            }
+            checked++;
+            pageNum++;
+        }
+        pthread_mutex_lock(&info->scrubLatch);
+        info->scrubStats.pagesChecked+=checked;
+        info->scrubStats.passes+=passes;
+        info->scrubStats.corruptPages+=corrupt;
+        if(lastCorrupt>=0)
+            info->scrubStats.lastCorruptPage=lastCorrupt;
+        //next batch starts SM_SCRUB_BATCH/scrubRate seconds after this one
+        pause=(long)(1000000000.0*SM_SCRUB_BATCH/info->scrubRate);
+        until.tv_sec+=pause/1000000000L;
+        until.tv_nsec+=pause%1000000000L;
+        if(until.tv_nsec>=1000000000L){
+            until.tv_sec++;
+            until.tv_nsec-=1000000000L;
+        }
+        //after falling behind the schedule starts from now, no catching up
+        clock_gettime(CLOCK_REALTIME,&now);
+        if(until.tv_sec<now.tv_sec)
+            until=now;
+        while(!info->scrubStop && pthread_cond_timedwait(&info->scrubWake,&info->scrubLatch,&until)==0);
+    }
+    pthread_mutex_unlock(&info->scrubLatch);
+    free(page);
+    return NULL;
+}
 
 /****************************************************************
- *Function Name: ensureCapacity
+ *Function Name: startScrubber / stopScrubber
  *
- * Description: If file has less number of pages append additional pages
+ * Description: Start a thread verifying the checksums of all pages of
+ *              a file opened with SM_OPEN_CHECKSUM, reading at most
+ *              pagesPerSecond pages per second so foreground I/O keeps
+ *              most of the device. Starting a running scrubber only
+ *              changes its rate. The findings are kept until the file is
+ *              closed, see getScrubStats
  *
  * Parameter:
- *        int numberOfPages
  *        SM_FileHandle *fHandle
+ *        int pagesPerSecond
  *
  * Return:
  *     RC: returned code
  ***************************************************************/
-RC ensureCapacity(int numberOfPages, SM_FileHandle *fHandle){
-    //check if totalNumPages is less than numberOfPages
-    if(fHandle->totalNumPages< numberOfPages){
-        int appendPage,i;
-        //determine the number of extra page to be appended
-        appendPage=numberOfPages-fHandle->totalNumPages;
-        for(i=0;i<appendPage;i++){
-            appendEmptyBlock(fHandle);
-            // printf("No of pages:%d", fHandle->totalNumPages);
-        }
-        //update file handle field
-        fHandle->totalNumPages=numberOfPages;
-        fHandle->curPagePos = fHandle->totalNumPages - 1;
+RC startScrubber(SM_FileHandle *fHandle, int pagesPerSecond){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    RC rc=RC_OK;
+    if(info==NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if(!(info->flags&SM_OPEN_CHECKSUM))
+        return RC_NO_CHECKSUMS;
+    pthread_mutex_lock(&info->scrubLatch);
+    info->scrubRate= pagesPerSecond>0 ? pagesPerSecond : 1;
+    if(!info->scrubbing){
+        info->scrubStop=0;
+        if(pthread_create(&info->scrubber,NULL,scrubMain,fHandle)==0)
+            info->scrubbing=1;
+        else
+            rc=RC_FILE_HANDLE_NOT_INIT;
+    }
+    pthread_cond_signal(&info->scrubWake);
+    pthread_mutex_unlock(&info->scrubLatch);
+    return rc;
+}
+
+RC stopScrubber(SM_FileHandle *fHandle){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    if(info==NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    pthread_mutex_lock(&info->scrubLatch);
+    if(!info->scrubbing){
+        pthread_mutex_unlock(&info->scrubLatch);
         return RC_OK;
     }
+    info->scrubStop=1;
+    pthread_cond_signal(&info->scrubWake);
+    pthread_mutex_unlock(&info->scrubLatch);
+    pthread_join(info->scrubber,NULL);
+    pthread_mutex_lock(&info->scrubLatch);
+    info->scrubbing=0;
+    pthread_mutex_unlock(&info->scrubLatch);
+    return RC_OK;
+}
+
+/****************************************************************
+ *Function Name: getScrubStats
+ *
+ * Description: Copy findings of the scrubber of the file to stats
+ *
+ * Parameter:
+ *        SM_FileHandle *fHandle
+ *        SM_ScrubStats *stats
+ *
+ * Return:
+ *     RC: returned code
+ ***************************************************************/
+RC getScrubStats(SM_FileHandle *fHandle, SM_ScrubStats *stats){
+    SM_FileInfo *info=(SM_FileInfo*)fHandle->mgmtInfo;
+    if(info==NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    pthread_mutex_lock(&info->scrubLatch);
+    *stats=info->scrubStats;
+    pthread_mutex_unlock(&info->scrubLatch);
     return RC_OK;
 }
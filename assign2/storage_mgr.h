@@ -18,39 +18,148 @@
 /************************************************************
  *                    handle data structures                *
  ************************************************************/
+/* page numbers and page counts of a file, 64 bit so files of more than
+   2^31 pages can be addressed */
+typedef long long PageNumber;
+
 typedef struct SM_FileHandle {
   char *fileName;
-  int totalNumPages;
-  int curPagePos;
+  PageNumber totalNumPages;
+  PageNumber curPagePos;
+  int pageSize;          /* bytes per page, recorded in the file header */
   void *mgmtInfo;
 } SM_FileHandle;
 
 typedef char* SM_PageHandle;
 
+/* queue of asynchronous page I/Os, see initIOQueue */
+typedef struct SM_IOQueue SM_IOQueue;
+
+typedef struct SM_IOCompletion {
+  void *userData;        /* as given to submitRead / submitWrite */
+  RC rc;
+} SM_IOCompletion;
+
+/* I/Os a queue keeps in flight if initIOQueue gets depth 0 */
+#define SM_IO_DEPTH 64
+
+/* findings of the scrubber, see startScrubber */
+typedef struct SM_ScrubStats {
+  long pagesChecked;     /* pages verified since the scrubber started */
+  int passes;            /* complete passes over the file */
+  int corruptPages;      /* checksum mismatches found, counted in every pass */
+  PageNumber lastCorruptPage; /* page of the last mismatch, -1 none */
+} SM_ScrubStats;
+
+/* I/O of one kind on a file, see getFileIOStats. latency[b] counts the
+   operations that took 2^b to 2^(b+1)-1 nanoseconds, the last bucket
+   also the longer ones */
+#define SM_LATENCY_BUCKETS 32
+typedef struct SM_IOClassStats {
+  long ops;
+  long bytes;
+  long latency[SM_LATENCY_BUCKETS];
+} SM_IOClassStats;
+
+/* I/O counters of an open file, longs only */
+typedef struct SM_IOStats {
+  SM_IOClassStats read;   /* page reads from the file, readahead window fills included */
+  SM_IOClassStats write;  /* writes of pages inside the file */
+  SM_IOClassStats append; /* writes behind the end and growing the file, bytes it grew by */
+  SM_IOClassStats sync;   /* fdatasync calls of syncPageFile */
+  SM_IOClassStats scrub;  /* verification reads of the scrubber, kept apart from read and seeks */
+  long seeks;             /* reads and writes not starting behind the page transferred last */
+} SM_IOStats;
+
+/* flags of openPageFileWithFlags */
+#define SM_OPEN_MMAP 1   /* map the file, getBlockPtr returns pointers into it */
+#define SM_OPEN_DIRECT 2 /* bypass the page cache, buffers must be SM_DIRECT_ALIGN aligned */
+#define SM_OPEN_CHECKSUM 4 /* keep a CRC32C of every page in its last SM_CHECKSUM_SIZE bytes */
+#define SM_DIRECT_ALIGN 4096
+#define SM_CHECKSUM_SIZE 4
+
+/* page sizes createPageFileWithSize accepts, powers of two no smaller
+   than SM_DIRECT_ALIGN so pages stay aligned. Files created by
+   createPageFile use PAGE_SIZE */
+#define SM_MIN_PAGE_SIZE SM_DIRECT_ALIGN
+#define SM_MAX_PAGE_SIZE 65536
+
+/* member files a tablespace stripes its pages across, see createTablespace */
+#define SM_MAX_STRIPES 16
+
+/* pages reserved at once when a file grows, see setExtentSize */
+#define SM_EXTENT_PAGES 256
+
+/* durability levels of setDurability: syncPageFile does nothing, calls
+   fdatasync, or merges the calls made within SM_GROUP_COMMIT_USEC into
+   one fdatasync */
+#define SM_DURABILITY_NONE 0
+#define SM_DURABILITY_SYNC 1
+#define SM_DURABILITY_GROUP 2
+#define SM_GROUP_COMMIT_USEC 200
+
+/* pages readBlock reads ahead of a run, see setReadahead */
+#define SM_READAHEAD_PAGES 32
+#define SM_MAX_READAHEAD 256
+
 /************************************************************
  *                    interface                             *
  ************************************************************/
 /* manipulating page files */
 extern void initStorageManager (void);
 extern RC createPageFile (char *fileName);
+extern RC createPageFileWithSize (char *fileName, int pageSize);
+extern RC createCompressedPageFile (char *fileName);
+extern RC createCompressedPageFileWithSize (char *fileName, int pageSize);
+extern RC createTablespace (char *fileName, char *const *dataFiles, int numFiles, int pageSize);
 extern RC openPageFile (char *fileName, SM_FileHandle *fHandle);
+extern RC openPageFileWithFlags (char *fileName, SM_FileHandle *fHandle, int flags);
 extern RC closePageFile (SM_FileHandle *fHandle);
 extern RC destroyPageFile (char *fileName);
 
 /* reading blocks from disc */
-extern RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
-extern int getBlockPos (SM_FileHandle *fHandle);
+extern RC readBlock (PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern PageNumber getBlockPos (SM_FileHandle *fHandle);
 extern RC readFirstBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern char *getBlockPtr (PageNumber pageNum, SM_FileHandle *fHandle);
+extern RC readBlocks (PageNumber startPage, int count, SM_FileHandle *fHandle, SM_PageHandle *memPages);
+extern RC setReadahead (SM_FileHandle *fHandle, int numPages);
 
 /* writing blocks to a page file */
-extern RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC writeBlock (PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC writeBlocks (PageNumber startPage, int count, SM_FileHandle *fHandle, SM_PageHandle *memPages);
 extern RC appendEmptyBlock (SM_FileHandle *fHandle);
-extern RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle);
+extern RC ensureCapacity (PageNumber numberOfPages, SM_FileHandle *fHandle);
+extern RC setExtentSize (SM_FileHandle *fHandle, int numPages);
+
+/* reusing freed pages, the free pages are chained from the file header */
+extern RC allocatePage (SM_FileHandle *fHandle, PageNumber *pageNum);
+extern RC freePage (PageNumber pageNum, SM_FileHandle *fHandle);
+extern PageNumber getFreePageCount (SM_FileHandle *fHandle);
+
+/* making written pages durable */
+extern RC setDurability (SM_FileHandle *fHandle, int level);
+extern RC syncPageFile (SM_FileHandle *fHandle);
+
+/* instrumentation */
+extern RC getFileIOStats (SM_FileHandle *fHandle, SM_IOStats *stats);
+
+/* verifying page checksums in the background */
+extern RC startScrubber (SM_FileHandle *fHandle, int pagesPerSecond);
+extern RC stopScrubber (SM_FileHandle *fHandle);
+extern RC getScrubStats (SM_FileHandle *fHandle, SM_ScrubStats *stats);
+
+/* asynchronous page I/O, a queue is used by one thread at a time */
+extern RC initIOQueue (SM_IOQueue **queue, int depth);
+extern RC shutdownIOQueue (SM_IOQueue *queue);
+extern RC submitRead (SM_IOQueue *queue, PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, void *userData);
+extern RC submitWrite (SM_IOQueue *queue, PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, void *userData);
+extern int pollCompletions (SM_IOQueue *queue, SM_IOCompletion *done, int max, int minWait);
 
 #endif
 
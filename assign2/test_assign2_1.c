@@ -7,6 +7,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <limits.h>
 
 // var to store the current test's name
 char *testName;
@@ -37,6 +40,29 @@ static void testReadPage (void);
 
 static void testFIFO (void);
 static void testLRU (void);
+static void testCLOCK (void);
+static void testLRU_K (void);
+static void testLFU (void);
+static void testARC (void);
+static void test2Q (void);
+static void testPoolRegistry (void);
+static void testConcurrentPool (void);
+static void testBackgroundWriter (void);
+static void testPositionalIO (void);
+static void testMappedPageFile (void);
+static void testDirectIO (void);
+static void testExtentGrowth (void);
+static void testVectoredIO (void);
+static void testAsyncIO (void);
+static void testPageChecksums (void);
+static void testCompressedPageFile (void);
+static void testPageSizes (void);
+static void testFreePages (void);
+static void testTablespace (void);
+static void testReadahead (void);
+static void testFlushRuns (void);
+static void testDurability (void);
+static void testIOStats (void);
 
 // main method
 int 
@@ -48,7 +74,30 @@ main (void)
   testCreatingAndReadingDummyPages();
   testReadPage();
   testFIFO();
- // testLRU();
+  testLRU();
+  testCLOCK();
+  testLRU_K();
+  testLFU();
+  testARC();
+  test2Q();
+  testPoolRegistry();
+  testConcurrentPool();
+  testBackgroundWriter();
+  testPositionalIO();
+  testMappedPageFile();
+  testDirectIO();
+  testExtentGrowth();
+  testVectoredIO();
+  testAsyncIO();
+  testPageChecksums();
+  testCompressedPageFile();
+  testPageSizes();
+  testFreePages();
+  testTablespace();
+  testReadahead();
+  testFlushRuns();
+  testDurability();
+  testIOStats();
 }
 
 // create n pages with content "Page X" and read them back to check whether the content is right
@@ -85,7 +134,7 @@ createDummyPages(BM_BufferPool *bm, int num)
   for (i = 0; i < num; i++)
     {
       CHECK(pinPage(bm, h, i));
-      sprintf(h->data, "%s-%i", "Page", h->pageNum);
+      sprintf(h->data, "%s-%lld", "Page", h->pageNum);
       CHECK(markDirty(bm, h));
       CHECK(unpinPage(bm,h));
     }
@@ -108,7 +157,7 @@ checkDummyPages(BM_BufferPool *bm, int num)
     {
       CHECK(pinPage(bm, h, i));
 
-      sprintf(expected, "%s-%i", "Page", h->pageNum);
+      sprintf(expected, "%s-%lld", "Page", h->pageNum);
       ASSERT_EQUALS_STRING(expected, h->data, "reading back dummy page content");
 
       CHECK(unpinPage(bm,h));
@@ -224,7 +273,291 @@ testFIFO ()
   free(h);
   TEST_DONE();
 }
-/*
+// test the CLOCK page replacement strategy
+void
+testCLOCK (void)
+{
+  // expected results
+  const char *poolContents[] = { 
+    // read first three pages and directly unpin them
+    "[0 0],[-1 0],[-1 0]" , 
+    "[0 0],[1 0],[-1 0]", 
+    "[0 0],[1 0],[2 0]",
+    // hand clears all reference bits and comes back to frame 0
+    "[3 0],[1 0],[2 0]",
+    // page 1 gets a second chance, so page 2 is replaced
+    "[3 0],[1 0],[2 0]",
+    "[3 0],[1 0],[4 0]",
+    "[3 0],[5 0],[4 0]",
+    "[3 0],[5 0],[4 0]",
+    "[3 0],[5 0],[6 0]",
+    // pin one page, replace another and flush
+    "[7x1],[5 0],[6 0]",
+    "[7x1],[8x0],[6 0]",
+    "[7x0],[8x0],[6 0]",
+    "[7 0],[8 0],[6 0]"
+  };
+  const int requests[] = {0,1,2,3,1,4,5,3,6};
+  const int numRequests = 9;
+
+  int i;
+  int snapshot = 0;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing CLOCK page replacement";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 100);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_CLOCK, NULL));
+
+  // read pages with direct unpin and no modifications
+  for(i = 0; i < numRequests; i++)
+  {
+      pinPage(bm, h, requests[i]);
+      unpinPage(bm, h);
+      ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "check pool content");
+  }
+
+  // keep page 7 pinned and modify it
+  pinPage(bm, h, 7);
+  markDirty(bm, h);
+  ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "pool content after pin page");
+
+  pinPage(bm, h, 8);
+  markDirty(bm, h);
+  unpinPage(bm, h);
+  ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "check pool content");
+
+  h->pageNum = 7;
+  unpinPage(bm, h);
+  ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "unpin last page");
+
+  forceFlushPool(bm);
+  ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "pool content after flush");
+
+  // check number of write IOs
+  ASSERT_EQUALS_INT(2, getNumWriteIO(bm), "check number of write I/Os");
+  ASSERT_EQUALS_INT(9, getNumReadIO(bm), "check number of read I/Os");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test the LRU-K page replacement strategy with K=2
+void
+testLRU_K (void)
+{
+  // expected results
+  const char *poolContents[] = { 
+    // read first three pages and directly unpin them
+    "[0 0],[-1 0],[-1 0]" , 
+    "[0 0],[1 0],[-1 0]", 
+    "[0 0],[1 0],[2 0]",
+    // reference pages 0 and 1 a second time
+    "[0 0],[1 0],[2 0]",
+    "[0 0],[1 0],[2 0]",
+    // pages referenced only once are replaced first
+    "[0 0],[1 0],[3 0]",
+    "[0 0],[1 0],[4 0]",
+    "[0 0],[1 0],[4 0]",
+    // page 0 has the oldest second to last reference
+    "[5 0],[1 0],[4 0]"
+  };
+  const int requests[] = {0,1,2,0,1,3,4,4,5};
+  const int numRequests = 9;
+  BM_LRUKParams params = { 2, 0 };
+
+  int i;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing LRU-K page replacement";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 100);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU_K, &params));
+
+  for(i = 0; i < numRequests; i++)
+  {
+      pinPage(bm, h, requests[i]);
+      unpinPage(bm, h);
+      ASSERT_EQUALS_POOL(poolContents[i], bm, "check pool content");
+  }
+
+  // check number of write IOs
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+  ASSERT_EQUALS_INT(6, getNumReadIO(bm), "check number of read I/Os");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test the LFU page replacement strategy
+void
+testLFU (void)
+{
+  // expected results
+  const char *poolContents[] = { 
+    // read first three pages and directly unpin them
+    "[0 0],[-1 0],[-1 0]" , 
+    "[0 0],[1 0],[-1 0]", 
+    "[0 0],[1 0],[2 0]",
+    // page 0 is used three times, page 1 twice
+    "[0 0],[1 0],[2 0]",
+    "[0 0],[1 0],[2 0]",
+    "[0 0],[1 0],[2 0]",
+    // pages used only once are replaced first
+    "[0 0],[1 0],[3 0]",
+    "[0 0],[1 0],[4 0]",
+    "[0 0],[1 0],[4 0]",
+    // pages 1 and 4 are both used twice, page 1 less recently
+    "[0 0],[5 0],[4 0]"
+  };
+  const int requests[] = {0,1,2,0,0,1,3,4,4,5};
+  const int numRequests = 10;
+
+  int i;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing LFU page replacement";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 100);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LFU, NULL));
+
+  for(i = 0; i < numRequests; i++)
+  {
+      pinPage(bm, h, requests[i]);
+      unpinPage(bm, h);
+      ASSERT_EQUALS_POOL(poolContents[i], bm, "check pool content");
+  }
+
+  // check number of write IOs
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+  ASSERT_EQUALS_INT(6, getNumReadIO(bm), "check number of read I/Os");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test the ARC page replacement strategy
+void
+testARC (void)
+{
+  // expected results
+  const char *poolContents[] = { 
+    // read first three pages and directly unpin them
+    "[0 0],[-1 0],[-1 0]" , 
+    "[0 0],[1 0],[-1 0]", 
+    "[0 0],[1 0],[2 0]",
+    // page 0 moves to the frequent list
+    "[0 0],[1 0],[2 0]",
+    // new pages replace pages used only once
+    "[0 0],[3 0],[2 0]",
+    "[0 0],[3 0],[4 0]",
+    // page 2 is in the recent ghost list, it grows the target of the recent list
+    "[0 0],[2 0],[4 0]",
+    // frequent list is now larger than its share
+    "[5 0],[2 0],[4 0]",
+    // page 0 is in the frequent ghost list
+    "[5 0],[2 0],[0 0]"
+  };
+  const int requests[] = {0,1,2,0,3,4,2,5,0};
+  const int numRequests = 9;
+
+  int i;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing ARC page replacement";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 100);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_ARC, NULL));
+
+  for(i = 0; i < numRequests; i++)
+  {
+      pinPage(bm, h, requests[i]);
+      unpinPage(bm, h);
+      ASSERT_EQUALS_POOL(poolContents[i], bm, "check pool content");
+  }
+
+  // check number of write IOs
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+  ASSERT_EQUALS_INT(8, getNumReadIO(bm), "check number of read I/Os");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test the 2Q page replacement strategy with kin=1 and kout=2
+void
+test2Q (void)
+{
+  // expected results
+  const char *poolContents[] = { 
+    // read first four pages and directly unpin them
+    "[0 0],[-1 0],[-1 0],[-1 0]" , 
+    "[0 0],[1 0],[-1 0],[-1 0]", 
+    "[0 0],[1 0],[2 0],[-1 0]",
+    "[0 0],[1 0],[2 0],[3 0]",
+    // pages leave A1in in FIFO order and are remembered in A1out
+    "[4 0],[1 0],[2 0],[3 0]",
+    // page 0 is in A1out and is loaded into Am
+    "[4 0],[0 0],[2 0],[3 0]",
+    "[4 0],[0 0],[5 0],[3 0]",
+    "[4 0],[0 0],[5 0],[6 0]",
+    "[4 0],[0 0],[5 0],[6 0]",
+    // page 1 was dropped from A1out, page 0 stays in Am
+    "[1 0],[0 0],[5 0],[6 0]",
+    "[1 0],[0 0],[3 0],[6 0]"
+  };
+  const int requests[] = {0,1,2,3,4,0,5,6,0,1,3};
+  const int numRequests = 11;
+  BM_2QParams params = { 1, 2 };
+
+  int i;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing 2Q page replacement";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 100);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_2Q, &params));
+
+  for(i = 0; i < numRequests; i++)
+  {
+      pinPage(bm, h, requests[i]);
+      unpinPage(bm, h);
+      ASSERT_EQUALS_POOL(poolContents[i], bm, "check pool content");
+  }
+
+  // check number of write IOs
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+  ASSERT_EQUALS_INT(10, getNumReadIO(bm), "check number of read I/Os");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
 // test the LRU page replacement strategy
 void
 testLRU (void)
@@ -244,7 +577,11 @@ testLRU (void)
     "[0 0],[1 0],[2 0],[3 0],[4 0]",
     "[0 0],[1 0],[2 0],[3 0],[4 0]",
     // check that pages get evicted in LRU order
-    
+    "[0 0],[1 0],[2 0],[5 0],[4 0]",
+    "[0 0],[1 0],[2 0],[5 0],[6 0]",
+    "[7 0],[1 0],[2 0],[5 0],[6 0]",
+    "[7 0],[1 0],[8 0],[5 0],[6 0]",
+    "[7 0],[9 0],[8 0],[5 0],[6 0]"
   };
   const int orderRequests[] = {3,4,0,2,1};
   const int numLRUOrderChange = 5;
@@ -293,4 +630,1300 @@ testLRU (void)
   free(bm);
   free(h);
   TEST_DONE();
-}*/
+}
+
+// test that pools keep their own state and share the frame budget of the registry
+void
+testPoolRegistry (void)
+{
+  int i;
+  BM_BufferPool *scan = MAKE_POOL();
+  BM_BufferPool *hot = MAKE_POOL();
+  BM_BufferPool *extra = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  const int hotRequests[] = {0,1,0,1,2};
+  testName = "Testing pool registry";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(scan, 100);
+  CHECK(createPageFile("testbuffer2.bin"));
+  createDummyPages(hot, 100);
+  CHECK(initPoolRegistry(6));
+  CHECK(initBufferPool(scan, "testbuffer.bin", 4, RS_FIFO, NULL));
+  CHECK(initBufferPool(hot, "testbuffer2.bin", 4, RS_FIFO, NULL));
+  ASSERT_EQUALS_INT(4, getPoolQuota(scan), "first pool gets all its frames");
+  ASSERT_EQUALS_INT(2, getPoolQuota(hot), "second pool gets the rest of the budget");
+  ASSERT_ERROR(initBufferPool(extra, "testbuffer.bin", 4, RS_FIFO, NULL), "budget is exhausted");
+
+  // scan never hits, the other pool reuses its pages
+  for(i = 0; i < 20; i++)
+  {
+      pinPage(scan, h, i);
+      unpinPage(scan, h);
+  }
+  for(i = 0; i < 5; i++)
+  {
+      pinPage(hot, h, hotRequests[i]);
+      unpinPage(hot, h);
+  }
+  ASSERT_EQUALS_INT(20, getNumReadIO(scan), "read I/Os of first pool");
+  ASSERT_EQUALS_INT(3, getNumReadIO(hot), "read I/Os of second pool");
+  ASSERT_EQUALS_POOL("[2 0],[1 0],[-1 0],[-1 0]", hot, "second pool is limited by its quota");
+
+  // a frame moves from the scanning pool to the pool with the higher hit ratio
+  CHECK(rebalanceBufferPools());
+  ASSERT_EQUALS_INT(3, getPoolQuota(scan), "quota after rebalance");
+  ASSERT_EQUALS_INT(3, getPoolQuota(hot), "quota after rebalance");
+  ASSERT_EQUALS_POOL("[-1 0],[17 0],[18 0],[19 0]", scan, "oldest page was given up");
+  pinPage(hot, h, 3);
+  unpinPage(hot, h);
+  ASSERT_EQUALS_POOL("[2 0],[1 0],[3 0],[-1 0]", hot, "second pool uses the new frame");
+
+  ASSERT_ERROR(shutdownPoolRegistry(), "pools are still registered");
+  CHECK(shutdownBufferPool(scan));
+  CHECK(shutdownBufferPool(hot));
+  CHECK(shutdownPoolRegistry());
+  CHECK(destroyPageFile("testbuffer.bin"));
+  CHECK(destroyPageFile("testbuffer2.bin"));
+
+  free(scan);
+  free(hot);
+  free(extra);
+  free(h);
+  TEST_DONE();
+}
+
+// pool and result shared with the threads of the concurrent test
+static BM_BufferPool *sharedPool;
+static int concurrentErrors;
+
+// pin pages of the shared pool one at a time and check their content
+static void *
+concurrentPins (void *arg)
+{
+  BM_PageHandle h;
+  char expected[64];
+  unsigned int seed = (unsigned int) (long) arg;
+  int i;
+
+  for(i = 0; i < 500; i++)
+  {
+      if (pinPage(sharedPool, &h, rand_r(&seed) % 10) != RC_OK)
+        __atomic_add_fetch(&concurrentErrors, 1, __ATOMIC_RELAXED);
+      sprintf(expected, "%s-%lld", "Page", h.pageNum);
+      if (strcmp(expected, h.data) != 0)
+        __atomic_add_fetch(&concurrentErrors, 1, __ATOMIC_RELAXED);
+      unpinPage(sharedPool, &h);
+  }
+  return NULL;
+}
+
+// pin a page while all frames of the shared pool are pinned
+static void *
+waitingPin (void *arg)
+{
+  BM_PageHandle *h = (BM_PageHandle *) arg;
+  if (pinPage(sharedPool, h, 5) != RC_OK)
+    concurrentErrors++;
+  return NULL;
+}
+
+// test several threads pinning pages of one pool
+void
+testConcurrentPool (void)
+{
+  int i;
+  pthread_t threads[4];
+  BM_PoolOptions options = { .concurrent = true, .numShards = 4 };
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *h2 = MAKE_PAGE_HANDLE();
+  BM_PageHandle *h3 = MAKE_PAGE_HANDLE();
+  BM_PageHandle *waiting = MAKE_PAGE_HANDLE();
+  int *fixCounts;
+  sharedPool = MAKE_POOL();
+  concurrentErrors = 0;
+  testName = "Testing concurrent pool";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(sharedPool, 10);
+  CHECK(initBufferPoolWithOptions(sharedPool, "testbuffer.bin", 3, RS_CLOCK, NULL, &options));
+
+  for(i = 0; i < 4; i++)
+    pthread_create(&threads[i], NULL, concurrentPins, (void *) (long) (i + 1));
+  for(i = 0; i < 4; i++)
+    pthread_join(threads[i], NULL);
+  ASSERT_EQUALS_INT(0, concurrentErrors, "all pins returned the right page");
+  fixCounts = getFixCounts(sharedPool);
+  ASSERT_TRUE(fixCounts[0] == 0 && fixCounts[1] == 0 && fixCounts[2] == 0, "no page is left pinned");
+  free(fixCounts);
+
+  // a pin waits for a frame instead of failing
+  CHECK(pinPage(sharedPool, h, 0));
+  CHECK(pinPage(sharedPool, h2, 1));
+  CHECK(pinPage(sharedPool, h3, 2));
+  pthread_create(&threads[0], NULL, waitingPin, waiting);
+  CHECK(unpinPage(sharedPool, h));
+  pthread_join(threads[0], NULL);
+  ASSERT_EQUALS_INT(0, concurrentErrors, "waiting pin succeeded");
+  ASSERT_EQUALS_STRING("Page-5", waiting->data, "waiting pin got its page");
+  CHECK(unpinPage(sharedPool, h2));
+  CHECK(unpinPage(sharedPool, h3));
+  CHECK(unpinPage(sharedPool, waiting));
+
+  CHECK(shutdownBufferPool(sharedPool));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(sharedPool);
+  free(h);
+  free(h2);
+  free(h3);
+  free(waiting);
+  TEST_DONE();
+}
+
+// test that the background writer cleans dirty frames before they are replaced
+void
+testBackgroundWriter (void)
+{
+  int i;
+  BM_PoolOptions options = { .cleanerHigh = 50, .cleanerLow = 0 };
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  bool *dirtyFlags;
+  testName = "Testing background writer";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, RS_FIFO, NULL, &options));
+
+  // writer starts at two dirty frames and cleans all of them
+  for (i = 0; i < 4; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%lld", "Page", h->pageNum);
+      CHECK(markDirty(bm, h));
+      CHECK(unpinPage(bm,h));
+    }
+  for (i = 0; i < 200 && getNumWriteIO(bm) < 4; i++)
+    usleep(10000);
+  ASSERT_EQUALS_INT(4, getNumWriteIO(bm), "writer wrote all dirty pages");
+  dirtyFlags = getDirtyFlags(bm);
+  ASSERT_TRUE(!dirtyFlags[0] && !dirtyFlags[1] && !dirtyFlags[2] && !dirtyFlags[3], "no frame is dirty");
+  free(dirtyFlags);
+
+  // replacing the clean frames needs no write
+  for (i = 4; i < 8; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm,h));
+    }
+  ASSERT_EQUALS_POOL("[4 0],[5 0],[6 0],[7 0]", bm, "all pages replaced");
+  ASSERT_EQUALS_INT(4, getNumWriteIO(bm), "no write on replacement");
+  ASSERT_EQUALS_INT(8, getNumReadIO(bm), "check number of read I/Os");
+
+  CHECK(shutdownBufferPool(bm));
+  checkDummyPages(bm, 4);
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test page positions and file growth of the storage manager
+void
+testPositionalIO (void)
+{
+  SM_FileHandle fh;
+  char *page = malloc(PAGE_SIZE);
+  char *read = malloc(PAGE_SIZE);
+  testName = "Testing positional page I/O";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(1, (int) fh.totalNumPages, "new file has one page");
+  ASSERT_TRUE(readBlock(1, &fh, read) == RC_READ_NON_EXISTING_PAGE, "page behind the end cannot be read");
+
+  // writing behind the end grows the file, skipped pages are empty
+  memset(page, 0, PAGE_SIZE);
+  strcpy(page, "Page-3");
+  CHECK(writeBlock(3, &fh, page));
+  ASSERT_EQUALS_INT(4, (int) fh.totalNumPages, "file grew to four pages");
+  ASSERT_EQUALS_INT(3, (int) getBlockPos(&fh), "written page is the current page");
+  CHECK(readBlock(2, &fh, read));
+  ASSERT_TRUE(read[0] == 0, "skipped page is empty");
+  CHECK(readNextBlock(&fh, read));
+  ASSERT_EQUALS_STRING("Page-3", read, "next block is page 3");
+  ASSERT_TRUE(readNextBlock(&fh, read) == RC_READ_NON_EXISTING_PAGE, "no page after the last page");
+  CHECK(readFirstBlock(&fh, read));
+  ASSERT_TRUE(readPreviousBlock(&fh, read) == RC_READ_NON_EXISTING_PAGE, "no page before the first page");
+  CHECK(readLastBlock(&fh, read));
+  ASSERT_EQUALS_STRING("Page-3", read, "last block is page 3");
+
+  CHECK(ensureCapacity(6, &fh));
+  ASSERT_EQUALS_INT(6, (int) fh.totalNumPages, "capacity ensured");
+  ASSERT_EQUALS_INT(5, (int) getBlockPos(&fh), "last appended page is the current page");
+  CHECK(closePageFile(&fh));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(page);
+  free(read);
+  TEST_DONE();
+}
+
+// test direct access to the pages of a mapped page file
+void
+testMappedPageFile (void)
+{
+  SM_FileHandle fh;
+  char *page = malloc(PAGE_SIZE);
+  char *ptr;
+  testName = "Testing mapped page file";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(openPageFileWithFlags("testbuffer.bin", &fh, SM_OPEN_MMAP));
+  memset(page, 0, PAGE_SIZE);
+  strcpy(page, "Page-0");
+  CHECK(writeBlock(0, &fh, page));
+  ptr = getBlockPtr(0, &fh);
+  ASSERT_TRUE(ptr != NULL, "page 0 is mapped");
+  ASSERT_EQUALS_STRING("Page-0", ptr, "write is visible through the mapping");
+  ASSERT_TRUE(getBlockPtr(1, &fh) == NULL, "no pointer behind the end");
+
+  // growing the file moves the mapping, pointers are fetched again
+  CHECK(ensureCapacity(600, &fh));
+  ASSERT_EQUALS_INT(600, (int) fh.totalNumPages, "capacity ensured");
+  ptr = getBlockPtr(599, &fh);
+  ASSERT_TRUE(ptr != NULL && ptr[0] == 0, "new page is empty");
+  strcpy(ptr, "Page-599");
+  strcpy(page, "Page-600");
+  CHECK(writeBlock(600, &fh, page));
+  ASSERT_EQUALS_STRING("Page-600", getBlockPtr(600, &fh), "appended page is mapped");
+  CHECK(closePageFile(&fh));
+
+  // changes made through the pointer are in the file
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(601, (int) fh.totalNumPages, "file has 601 pages");
+  CHECK(readBlock(599, &fh, page));
+  ASSERT_EQUALS_STRING("Page-599", page, "page written through the mapping");
+  CHECK(readBlock(0, &fh, page));
+  ASSERT_EQUALS_STRING("Page-0", page, "page written with writeBlock");
+  ASSERT_TRUE(getBlockPtr(0, &fh) == NULL, "file is not mapped");
+  CHECK(closePageFile(&fh));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(page);
+  TEST_DONE();
+}
+
+// test a pool doing direct I/O and the alignment check of the storage manager
+void
+testDirectIO (void)
+{
+  int i;
+  BM_PoolOptions options = { .directIO = true };
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  char *buf = malloc(PAGE_SIZE + 1);
+  testName = "Testing direct I/O";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 3, RS_LRU, NULL, &options));
+  for (i = 0; i < 6; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%lld", "Page", h->pageNum);
+      CHECK(markDirty(bm, h));
+      CHECK(unpinPage(bm,h));
+    }
+  ASSERT_EQUALS_INT(3, getNumWriteIO(bm), "replaced pages were written");
+  CHECK(shutdownBufferPool(bm));
+  checkDummyPages(bm, 6);
+
+  CHECK(openPageFileWithFlags("testbuffer.bin", &fh, SM_OPEN_DIRECT));
+  ASSERT_TRUE(readBlock(0, &fh, buf + 1) == RC_BAD_ALIGNMENT, "unaligned buffer is rejected");
+  ASSERT_TRUE(writeBlock(0, &fh, buf + 1) == RC_BAD_ALIGNMENT, "unaligned buffer is rejected");
+  CHECK(closePageFile(&fh));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(buf);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test growing a page file in extents without writing the new pages
+void
+testExtentGrowth (void)
+{
+  SM_FileHandle fh;
+  char *page = malloc(PAGE_SIZE);
+  testName = "Testing extent growth";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  CHECK(setExtentSize(&fh, 1024));
+  CHECK(ensureCapacity(20000, &fh));
+  ASSERT_EQUALS_INT(20000, (int) fh.totalNumPages, "file grew to 20000 pages");
+  ASSERT_EQUALS_INT(19999, (int) getBlockPos(&fh), "last new page is the current page");
+  memset(page, 1, PAGE_SIZE);
+  CHECK(readBlock(19999, &fh, page));
+  ASSERT_TRUE(page[0] == 0 && page[PAGE_SIZE - 1] == 0, "new page is empty");
+  CHECK(appendEmptyBlock(&fh));
+  ASSERT_EQUALS_INT(20001, (int) fh.totalNumPages, "one page appended");
+  CHECK(ensureCapacity(10, &fh));
+  ASSERT_EQUALS_INT(20001, (int) fh.totalNumPages, "file does not shrink");
+  CHECK(closePageFile(&fh));
+
+  // reserved extents are not counted as pages
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(20001, (int) fh.totalNumPages, "size survives reopening");
+  CHECK(closePageFile(&fh));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(page);
+  TEST_DONE();
+}
+
+// test reading and writing ranges of pages, larger than one preadv call
+void
+testVectoredIO (void)
+{
+  int i, errors = 0;
+  SM_FileHandle fh;
+  char *memory = malloc(2 * 600 * PAGE_SIZE);
+  SM_PageHandle out[600];
+  SM_PageHandle in[600];
+  testName = "Testing vectored page I/O";
+
+  for (i = 0; i < 600; i++)
+    {
+      out[i] = memory + i * PAGE_SIZE;
+      in[i] = memory + (600 + i) * PAGE_SIZE;
+      memset(out[i], 0, PAGE_SIZE);
+      sprintf(out[i], "%s-%i", "Page", i + 1);
+    }
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  CHECK(writeBlocks(1, 600, &fh, out));
+  ASSERT_EQUALS_INT(601, (int) fh.totalNumPages, "file grew to 601 pages");
+  ASSERT_EQUALS_INT(600, (int) getBlockPos(&fh), "last page written is the current page");
+  ASSERT_TRUE(readBlocks(2, 600, &fh, in) == RC_READ_NON_EXISTING_PAGE, "range behind the end cannot be read");
+  CHECK(readBlocks(1, 600, &fh, in));
+  for (i = 0; i < 600; i++)
+    if (memcmp(in[i], out[i], PAGE_SIZE) != 0)
+      errors++;
+  ASSERT_EQUALS_INT(0, errors, "all pages read back");
+  CHECK(closePageFile(&fh));
+
+  CHECK(openPageFileWithFlags("testbuffer.bin", &fh, SM_OPEN_MMAP));
+  memset(in[0], 0, PAGE_SIZE);
+  CHECK(readBlocks(300, 2, &fh, in));
+  ASSERT_EQUALS_STRING("Page-301", in[1], "range read from the mapping");
+  CHECK(closePageFile(&fh));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(memory);
+  TEST_DONE();
+}
+
+// submit page reads and writes to an I/O queue and prefetch pages into a pool
+void
+testAsyncIO (void)
+{
+  int i, k, n, errors = 0, pageNo[8];
+  char expected[32];
+  PageNumber *contents;
+  SM_FileHandle fh;
+  SM_IOQueue *queue;
+  SM_IOCompletion done[8];
+  char *memory = malloc(16 * PAGE_SIZE);
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  PageNumber pages[6] = {1, 2, 3, 2, 40, 4};
+  testName = "Testing asynchronous page I/O";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  CHECK(ensureCapacity(8, &fh));
+  CHECK(initIOQueue(&queue, 4));
+  for (i = 0; i < 4; i++)
+    {
+      memset(memory + i * PAGE_SIZE, 0, PAGE_SIZE);
+      sprintf(memory + i * PAGE_SIZE, "%s-%i", "Page", i + 1);
+      pageNo[i] = i + 1;
+      CHECK(submitWrite(queue, i + 1, &fh, memory + i * PAGE_SIZE, &pageNo[i]));
+    }
+  ASSERT_TRUE(submitWrite(queue, 5, &fh, memory, NULL) == RC_IO_QUEUE_FULL, "queue holds depth I/Os");
+  for (n = 0; n < 4; )
+    {
+      k = pollCompletions(queue, done, 8, 4 - n);
+      for (i = 0; i < k; i++)
+        if (done[i].rc != RC_OK || *(int *) done[i].userData < 1 || *(int *) done[i].userData > 4)
+          errors++;
+      n += k;
+    }
+  ASSERT_EQUALS_INT(0, errors, "all writes completed");
+  ASSERT_EQUALS_INT(7, (int) getBlockPos(&fh), "asynchronous I/O keeps the current page");
+
+  for (i = 0; i < 4; i++)
+    CHECK(submitRead(queue, 4 - i, &fh, memory + (8 + i) * PAGE_SIZE, NULL));
+  ASSERT_TRUE(submitRead(queue, 8, &fh, memory, NULL) == RC_READ_NON_EXISTING_PAGE, "page behind the end cannot be read");
+  for (n = 0; n < 4; )
+    n += pollCompletions(queue, done, 8, 1);
+  ASSERT_EQUALS_STRING("Page-4", memory + 8 * PAGE_SIZE, "first page read");
+  ASSERT_EQUALS_STRING("Page-1", memory + 11 * PAGE_SIZE, "last page read");
+  CHECK(shutdownIOQueue(queue));
+  CHECK(closePageFile(&fh));
+
+  // page 4 only gets a frame whose read is complete, so every frame holds its own page
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+  CHECK(prefetchPages(bm, pages, 6));
+  ASSERT_EQUALS_INT(4, getNumReadIO(bm), "prefetch read pages once");
+  contents = getFrameContents(bm);
+  for (i = 0; i < 3; i++)
+    {
+      CHECK(pinPage(bm, h, contents[i]));
+      sprintf(expected, "%s-%lld", "Page", contents[i]);
+      if (strcmp(expected, h->data) != 0)
+	errors++;
+    }
+  ASSERT_EQUALS_INT(4, getNumReadIO(bm), "pins of prefetched pages are hits");
+  ASSERT_EQUALS_INT(0, errors, "in-flight frames are not reused");
+  ASSERT_TRUE(contents[0] == 4 || contents[1] == 4 || contents[2] == 4, "page 4 is prefetched");
+  CHECK(prefetchPages(bm, pages, 1));
+  ASSERT_EQUALS_INT(4, getNumReadIO(bm), "no frame to prefetch into");
+  for (i = 0; i < 3; i++)
+    {
+      h->pageNum = contents[i];
+      CHECK(unpinPage(bm, h));
+    }
+  free(contents);
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(memory);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// detect a damaged page on read, by the scrubber and in the buffer pool
+void
+testPageChecksums (void)
+{
+  int i;
+  SM_FileHandle fh, raw;
+  SM_ScrubStats stats;
+  SM_IOStats before, after;
+  SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options = { .checksums = true };
+  testName = "Testing page checksums";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(openPageFileWithFlags("testbuffer.bin", &fh, SM_OPEN_CHECKSUM));
+  CHECK(ensureCapacity(3, &fh));
+  CHECK(readBlock(2, &fh, ph));
+  memset(ph, 0, PAGE_SIZE);
+  sprintf(ph, "%s-%i", "Page", 1);
+  CHECK(writeBlock(1, &fh, ph));
+  ASSERT_TRUE(ph[PAGE_SIZE - 1] == 0, "a sealed copy is written, not the page");
+  memset(ph, 0, PAGE_SIZE);
+  CHECK(readBlock(1, &fh, ph));
+  ASSERT_EQUALS_STRING("Page-1", ph, "page verified on read");
+
+  // change one byte without updating the checksum
+  CHECK(openPageFile("testbuffer.bin", &raw));
+  CHECK(readBlock(1, &raw, ph));
+  ph[100] ^= 1;
+  CHECK(writeBlock(1, &raw, ph));
+  ASSERT_TRUE(startScrubber(&raw, 1000) == RC_NO_CHECKSUMS, "scrubber needs checksums");
+  CHECK(closePageFile(&raw));
+  ASSERT_TRUE(readBlock(1, &fh, ph) == RC_CHECKSUM_MISMATCH, "damaged page detected on read");
+
+  CHECK(getFileIOStats(&fh, &before));
+  CHECK(startScrubber(&fh, 1000));
+  for (i = 0; i < 2000; i++)
+    {
+      CHECK(getScrubStats(&fh, &stats));
+      if (stats.passes > 0)
+	break;
+      usleep(1000);
+    }
+  CHECK(stopScrubber(&fh));
+  ASSERT_TRUE(stats.passes > 0, "scrubber walked the file");
+  ASSERT_TRUE(stats.corruptPages > 0, "scrubber found the damaged page");
+  ASSERT_EQUALS_INT(1, (int) stats.lastCorruptPage, "damaged page number");
+  CHECK(getFileIOStats(&fh, &after));
+  ASSERT_EQUALS_INT((int) before.read.ops, (int) after.read.ops, "scrubber reads are not foreground reads");
+  ASSERT_EQUALS_INT((int) before.seeks, (int) after.seeks, "scrubber reads are no seeks");
+  ASSERT_TRUE(after.scrub.ops >= stats.pagesChecked, "scrubber reads counted apart");
+  CHECK(closePageFile(&fh));
+
+  // the pool reports the page until it is written again
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 3, RS_FIFO, NULL, &options));
+  ASSERT_TRUE(pinPage(bm, h, 1) == RC_CHECKSUM_MISMATCH, "pin of damaged page");
+  ASSERT_EQUALS_STRING("Page-1", h->data, "damaged page is pinned anyway");
+  CHECK(unpinPage(bm, h));
+  ASSERT_TRUE(pinPage(bm, h, 1) == RC_CHECKSUM_MISMATCH, "damaged page stays reported");
+  CHECK(markDirty(bm, h));
+  CHECK(forcePage(bm, h));
+  CHECK(unpinPage(bm, h));
+  CHECK(pinPage(bm, h, 1));
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(openPageFileWithFlags("testbuffer.bin", &fh, SM_OPEN_CHECKSUM));
+  CHECK(readBlock(1, &fh, ph));
+  CHECK(closePageFile(&fh));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(ph);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// fill page with text which compresses, or with random bytes which do not
+static void
+fillPage (SM_PageHandle ph, int pageNum, bool random)
+{
+  int i;
+  for (i = 0; i < PAGE_SIZE; i++)
+    ph[i] = random ? (char) rand() : "Page-0123456789 record data "[(i + pageNum) % 28];
+  sprintf(ph, "%s-%i", "Page", pageNum);
+}
+
+// write compressible and incompressible pages to a compressed page file
+void
+testCompressedPageFile (void)
+{
+  int i, n, errors = 0;
+  long size;
+  unsigned int before[3], after[3];
+  FILE *file;
+  SM_FileHandle fh;
+  SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  SM_PageHandle expected = (SM_PageHandle) malloc(PAGE_SIZE);
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing compressed page files";
+
+  CHECK(createCompressedPageFile("testbuffer.bin"));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(1, (int) fh.totalNumPages, "new file has one page");
+  CHECK(readBlock(0, &fh, ph));
+  ASSERT_EQUALS_INT(0, ph[0], "new page is empty");
+  srand(7);
+  for (i = 0; i < 50; i++)
+    {
+      fillPage(ph, i, false);
+      CHECK(writeBlock(i, &fh, ph));
+    }
+  fillPage(ph, 50, true);
+  CHECK(writeBlock(50, &fh, ph));
+  ASSERT_EQUALS_INT(51, (int) fh.totalNumPages, "file grew to 51 pages");
+  // page 3 no longer fits into its sectors and moves
+  fillPage(ph, 3, true);
+  CHECK(writeBlock(3, &fh, ph));
+  CHECK(closePageFile(&fh));
+
+  file = fopen("testbuffer.bin", "r");
+  fseek(file, 0, SEEK_END);
+  size = ftell(file);
+  fclose(file);
+  ASSERT_TRUE(size < 51 * PAGE_SIZE / 4, "pages are stored compressed");
+
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(51, (int) fh.totalNumPages, "page count kept in the page map");
+  srand(7);
+  for (i = 0; i <= 50; i++)
+    {
+      fillPage(expected, i, i == 50);
+      if (i == 3)
+	continue;
+      CHECK(readBlock(i, &fh, ph));
+      if (memcmp(ph, expected, PAGE_SIZE) != 0)
+	errors++;
+    }
+  fillPage(expected, 3, true);
+  CHECK(readBlock(3, &fh, ph));
+  if (memcmp(ph, expected, PAGE_SIZE) != 0)
+    errors++;
+  ASSERT_EQUALS_INT(0, errors, "all pages read back");
+  // page 3 takes the sectors page 4 left when it grew
+  fillPage(ph, 4, true);
+  CHECK(writeBlock(4, &fh, ph));
+  fillPage(ph, 3, false);
+  CHECK(writeBlock(3, &fh, ph));
+  CHECK(ensureCapacity(60, &fh));
+  CHECK(readBlock(59, &fh, ph));
+  ASSERT_EQUALS_INT(0, ph[0], "added page is empty");
+  // a rewrite of the same size goes to fresh sectors, the entry (64 byte header, 12 byte entries) moves after it
+  file = fopen("testbuffer.bin.pmap", "r");
+  fseek(file, 64 + 12 * 10, SEEK_SET);
+  n = (int) fread(before, sizeof(unsigned int), 3, file);
+  ASSERT_EQUALS_INT(3, n, "page map entry read");
+  fclose(file);
+  fillPage(ph, 10, false);
+  CHECK(writeBlock(10, &fh, ph));
+  file = fopen("testbuffer.bin.pmap", "r");
+  fseek(file, 64 + 12 * 10, SEEK_SET);
+  n = (int) fread(after, sizeof(unsigned int), 3, file);
+  ASSERT_EQUALS_INT(3, n, "page map entry read");
+  fclose(file);
+  ASSERT_TRUE(before[0] != after[0] && before[1] == after[1], "rewritten page is not written over its old sectors");
+  CHECK(readBlock(10, &fh, ph));
+  ASSERT_EQUALS_STRING("Page-10", ph, "rewritten page read back");
+  CHECK(closePageFile(&fh));
+
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  CHECK(pinPage(bm, h, 3));
+  fillPage(expected, 3, false);
+  ASSERT_TRUE(memcmp(h->data, expected, PAGE_SIZE) == 0, "pool reads compressed page");
+  CHECK(pinPage(bm, h, 10));
+  ASSERT_EQUALS_STRING("Page-10", h->data, "pool reads compressed page");
+  CHECK(markDirty(bm, h));
+  CHECK(unpinPage(bm, h));
+  h->pageNum = 3;
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+  file = fopen("testbuffer.bin.pmap", "r");
+  ASSERT_TRUE(file == NULL, "page map removed with the file");
+
+  free(ph);
+  free(expected);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// fill pageSize bytes of page with the letter of pageNum behind its name
+static void
+fillSizedPage (SM_PageHandle ph, int pageNum, int pageSize)
+{
+  memset(ph, 'a' + pageNum, pageSize);
+  sprintf(ph, "%s-%i", "Page", pageNum);
+}
+
+// page files of 32 KB, 8 KB and compressed 64 KB pages
+void
+testPageSizes (void)
+{
+  int i, errors = 0;
+  long size;
+  FILE *file;
+  SM_FileHandle fh;
+  SM_IOQueue *queue;
+  SM_IOCompletion done;
+  SM_PageHandle ph = (SM_PageHandle) malloc(SM_MAX_PAGE_SIZE);
+  SM_PageHandle expected = (SM_PageHandle) malloc(SM_MAX_PAGE_SIZE);
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options = { .checksums = true };
+  testName = "Testing page sizes per page file";
+
+  ASSERT_EQUALS_INT(RC_BAD_PAGE_SIZE, createPageFileWithSize("testbuffer.bin", 3000), "page size is a power of two");
+  ASSERT_EQUALS_INT(RC_BAD_PAGE_SIZE, createPageFileWithSize("testbuffer.bin", 2 * SM_MAX_PAGE_SIZE), "page size is limited");
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(PAGE_SIZE, fh.pageSize, "default page size");
+  CHECK(closePageFile(&fh));
+
+  // 32 KB pages, read back through the mapping and asynchronous I/O
+  CHECK(createPageFileWithSize("testbuffer.bin", 32768));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(32768, fh.pageSize, "page size read from the header");
+  ASSERT_EQUALS_INT(1, (int) fh.totalNumPages, "new file has one page");
+  for (i = 0; i < 4; i++)
+    {
+      fillSizedPage(ph, i, 32768);
+      CHECK(writeBlock(i, &fh, ph));
+    }
+  CHECK(closePageFile(&fh));
+  CHECK(openPageFileWithFlags("testbuffer.bin", &fh, SM_OPEN_MMAP));
+  ASSERT_EQUALS_INT(4, (int) fh.totalNumPages, "file grew by 32 KB pages");
+  for (i = 0; i < 4; i++)
+    {
+      fillSizedPage(expected, i, 32768);
+      CHECK(readBlock(i, &fh, ph));
+      if (memcmp(ph, expected, 32768) != 0)
+	errors++;
+    }
+  ASSERT_EQUALS_INT(0, errors, "all pages read back");
+  ASSERT_TRUE(getBlockPtr(3, &fh)[32767] == 'd', "mapping holds whole pages");
+  CHECK(closePageFile(&fh));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  CHECK(initIOQueue(&queue, 4));
+  memset(ph, 0, 32768);
+  CHECK(submitRead(queue, 2, &fh, ph, NULL));
+  i = pollCompletions(queue, &done, 1, 1);
+  ASSERT_EQUALS_INT(1, i, "read completes");
+  CHECK(done.rc);
+  ASSERT_TRUE(ph[32767] == 'c', "asynchronous read of a whole page");
+  CHECK(shutdownIOQueue(queue));
+  CHECK(closePageFile(&fh));
+
+  // 8 KB pages with checksums through a buffer pool
+  CHECK(createPageFileWithSize("testbuffer.bin", 8192));
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 3, RS_LRU, NULL, &options));
+  ASSERT_EQUALS_INT(8192 - SM_CHECKSUM_SIZE, getPoolPageSize(bm), "pool uses the page size of the file less the checksum");
+  for (i = 0; i < 10; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      fillSizedPage(h->data, i, getPoolPageSize(bm));
+      CHECK(markDirty(bm, h));
+      CHECK(unpinPage(bm, h));
+    }
+  for (i = 0; i < 10; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      fillSizedPage(expected, i, 8192 - SM_CHECKSUM_SIZE);
+      if (memcmp(h->data, expected, 8192 - SM_CHECKSUM_SIZE) != 0)
+	errors++;
+      CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_INT(0, errors, "pool reads 8 KB pages back");
+  CHECK(shutdownBufferPool(bm));
+  CHECK(openPageFileWithFlags("testbuffer.bin", &fh, SM_OPEN_CHECKSUM));
+  ASSERT_EQUALS_INT(10, (int) fh.totalNumPages, "pool wrote 8 KB pages");
+  CHECK(readBlock(9, &fh, ph));
+  ASSERT_TRUE(ph[8191 - SM_CHECKSUM_SIZE] == 'j', "last byte of the page written");
+  CHECK(closePageFile(&fh));
+
+  // compressed 64 KB pages, the page size is kept in the page map
+  CHECK(createCompressedPageFileWithSize("testbuffer.bin", SM_MAX_PAGE_SIZE));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  fillSizedPage(ph, 0, SM_MAX_PAGE_SIZE);
+  CHECK(writeBlock(0, &fh, ph));
+  srand(19);
+  for (i = 0; i < SM_MAX_PAGE_SIZE; i++)
+    ph[i] = (char) rand();
+  CHECK(writeBlock(1, &fh, ph));
+  CHECK(closePageFile(&fh));
+  file = fopen("testbuffer.bin", "r");
+  fseek(file, 0, SEEK_END);
+  size = ftell(file);
+  fclose(file);
+  ASSERT_TRUE(size < SM_MAX_PAGE_SIZE + SM_MAX_PAGE_SIZE / 4, "first page stored compressed");
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(SM_MAX_PAGE_SIZE, fh.pageSize, "page size read from the page map");
+  fillSizedPage(expected, 0, SM_MAX_PAGE_SIZE);
+  CHECK(readBlock(0, &fh, ph));
+  if (memcmp(ph, expected, SM_MAX_PAGE_SIZE) != 0)
+    errors++;
+  srand(19);
+  for (i = 0; i < SM_MAX_PAGE_SIZE; i++)
+    expected[i] = (char) rand();
+  CHECK(readBlock(1, &fh, ph));
+  if (memcmp(ph, expected, SM_MAX_PAGE_SIZE) != 0)
+    errors++;
+  ASSERT_EQUALS_INT(0, errors, "compressed pages read back");
+  CHECK(closePageFile(&fh));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(ph);
+  free(expected);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// free pages and allocate them again through the storage and buffer manager
+void
+testFreePages (void)
+{
+  int i;
+  PageNumber page;
+  FILE *file;
+  SM_FileHandle fh;
+  SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing free page chain";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  for (i = 0; i < 5; i++)
+    {
+      memset(ph, 0, PAGE_SIZE);
+      sprintf(ph, "%s-%i", "Page", i);
+      CHECK(writeBlock(i, &fh, ph));
+    }
+  CHECK(freePage(1, &fh));
+  CHECK(freePage(3, &fh));
+  ASSERT_EQUALS_INT(2, (int) getFreePageCount(&fh), "two pages free");
+  ASSERT_EQUALS_INT(RC_PAGE_NOT_ALLOCATED, freePage(3, &fh), "page cannot be freed twice");
+  ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, freePage(10, &fh), "page must be in the file");
+  CHECK(closePageFile(&fh));
+
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(2, (int) getFreePageCount(&fh), "chain kept in the header");
+  CHECK(allocatePage(&fh, &page));
+  ASSERT_EQUALS_INT(3, (int) page, "page freed last is reused first");
+  CHECK(readBlock(3, &fh, ph));
+  ASSERT_EQUALS_INT(0, ph[0], "reused page is empty");
+  CHECK(allocatePage(&fh, &page));
+  ASSERT_EQUALS_INT(1, (int) page, "second free page reused");
+  CHECK(allocatePage(&fh, &page));
+  ASSERT_EQUALS_INT(5, (int) page, "file grows when no page is free");
+  ASSERT_EQUALS_INT(6, (int) fh.totalNumPages, "one page appended");
+  CHECK(readBlock(4, &fh, ph));
+  ASSERT_EQUALS_STRING("Page-4", ph, "pages in use are kept");
+  CHECK(closePageFile(&fh));
+
+  // a dirty copy in the pool must not overwrite the free page record
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+  CHECK(pinPage(bm, h, 2));
+  sprintf(h->data, "%s", "changed");
+  CHECK(markDirty(bm, h));
+  CHECK(unpinPage(bm, h));
+  CHECK(freePoolPage(bm, 2));
+  CHECK(pinPage(bm, h, 4));
+  ASSERT_EQUALS_INT(RC_PINNED_NOT_OUT, freePoolPage(bm, 4), "pinned page is not freed");
+  CHECK(unpinPage(bm, h));
+  CHECK(forceFlushPool(bm));
+  CHECK(allocatePoolPage(bm, &page));
+  ASSERT_EQUALS_INT(2, (int) page, "pool reuses freed page");
+  CHECK(pinPage(bm, h, 2));
+  ASSERT_EQUALS_INT(0, h->data[0], "allocated page is empty");
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(0, (int) getFreePageCount(&fh), "no page left free");
+  CHECK(readBlock(2, &fh, ph));
+  ASSERT_EQUALS_INT(0, ph[0], "dropped changes not written");
+  CHECK(closePageFile(&fh));
+
+  // a free the file rejects keeps the dirty copy in the pool
+  memset(ph, 0, PAGE_SIZE);
+  file = fopen("testbuffer.bin", "w");
+  for (i = 0; i < 3; i++)
+    fwrite(ph, 1, PAGE_SIZE, file);
+  fclose(file);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+  CHECK(pinPage(bm, h, 1));
+  sprintf(h->data, "%s", "kept");
+  CHECK(markDirty(bm, h));
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_INT(RC_NO_FILE_HEADER, freePoolPage(bm, 1), "file without header has no free chain");
+  CHECK(pinPage(bm, h, 1));
+  ASSERT_EQUALS_STRING("kept", h->data, "changes of the page kept in the pool");
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  CHECK(readBlock(1, &fh, ph));
+  ASSERT_EQUALS_STRING("kept", ph, "changes of the page written back");
+  CHECK(closePageFile(&fh));
+
+  // compressed files keep the chain in the header of their page map
+  CHECK(createCompressedPageFile("testbuffer.bin"));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  CHECK(ensureCapacity(3, &fh));
+  CHECK(freePage(0, &fh));
+  CHECK(closePageFile(&fh));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(1, (int) getFreePageCount(&fh), "chain kept in the page map");
+  CHECK(allocatePage(&fh, &page));
+  ASSERT_EQUALS_INT(0, (int) page, "compressed page reused");
+  CHECK(closePageFile(&fh));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(ph);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// pages striped across three member files
+void
+testTablespace (void)
+{
+  int i, n;
+  PageNumber page, big;
+  FILE *f;
+  char *members[] = {"testts.bin.0", "testts.bin.1", "testts.bin.2"};
+  SM_FileHandle fh;
+  SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  SM_PageHandle pages[7];
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing striped tablespace";
+
+  ASSERT_EQUALS_INT(RC_BAD_STRIPES, createTablespace("testts.bin", members, SM_MAX_STRIPES + 1, PAGE_SIZE), "too many members");
+  CHECK(createTablespace("testts.bin", members, 3, PAGE_SIZE));
+  CHECK(openPageFile("testts.bin", &fh));
+  ASSERT_EQUALS_INT(1, (int) fh.totalNumPages, "new tablespace has one page");
+  for (i = 0; i < 7; i++)
+    pages[i] = (SM_PageHandle) malloc(PAGE_SIZE);
+  for (i = 0; i < 7; i++)
+    {
+      memset(pages[i], 0, PAGE_SIZE);
+      sprintf(pages[i], "%s-%i", "Page", i);
+    }
+  CHECK(writeBlocks(0, 7, &fh, pages));
+  CHECK(writeBlock(9, &fh, pages[0]));
+  ASSERT_EQUALS_INT(10, (int) fh.totalNumPages, "writing behind the end grows the tablespace");
+  CHECK(closePageFile(&fh));
+
+  // page 4 is page 1 of the second member
+  f = fopen("testts.bin.1", "r");
+  ASSERT_TRUE(f != NULL, "member exists");
+  fseek(f, PAGE_SIZE, SEEK_SET);
+  n = (int) fread(ph, 1, PAGE_SIZE, f);
+  ASSERT_EQUALS_INT(PAGE_SIZE, n, "member holds its pages");
+  ASSERT_EQUALS_STRING("Page-4", ph, "pages are striped round-robin");
+  fclose(f);
+
+  CHECK(openPageFile("testts.bin", &fh));
+  ASSERT_EQUALS_INT(10, (int) fh.totalNumPages, "page count over all members");
+  for (i = 0; i < 7; i++)
+    memset(pages[i], 0, PAGE_SIZE);
+  CHECK(readBlocks(1, 6, &fh, pages));
+  for (i = 0; i < 6; i++)
+    {
+      sprintf(ph, "%s-%i", "Page", i + 1);
+      ASSERT_EQUALS_STRING(ph, pages[i], "read across the members");
+    }
+  CHECK(readBlock(9, &fh, ph));
+  ASSERT_EQUALS_STRING("Page-0", ph, "page behind the gap");
+  CHECK(readBlock(8, &fh, ph));
+  ASSERT_EQUALS_INT(0, ph[0], "page in the gap is empty");
+  CHECK(freePage(2, &fh));
+  CHECK(ensureCapacity(12, &fh));
+  CHECK(closePageFile(&fh));
+
+  CHECK(initBufferPool(bm, "testts.bin", 3, RS_LRU, NULL));
+  CHECK(allocatePoolPage(bm, &page));
+  ASSERT_EQUALS_INT(2, (int) page, "free chain kept in the tablespace header");
+  for (i = 0; i < 12; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%i", "Page", 100 + i);
+      CHECK(markDirty(bm, h));
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(shutdownBufferPool(bm));
+  CHECK(openPageFile("testts.bin", &fh));
+  ASSERT_EQUALS_INT(12, (int) fh.totalNumPages, "pool keeps the size");
+  CHECK(readBlock(11, &fh, ph));
+  ASSERT_EQUALS_STRING("Page-111", ph, "pool writes through the members");
+  CHECK(closePageFile(&fh));
+
+  CHECK(destroyPageFile("testts.bin"));
+  ASSERT_TRUE(fopen("testts.bin.2", "r") == NULL, "members are destroyed");
+
+  // page numbers above INT_MAX, in a sparse file behind the header page
+  CHECK(createPageFile("testbig.bin"));
+  ASSERT_TRUE(truncate("testbig.bin", ((off_t) INT_MAX + 5) * PAGE_SIZE) == 0, "sparse file of more than INT_MAX pages");
+  CHECK(openPageFile("testbig.bin", &fh));
+  ASSERT_TRUE(fh.totalNumPages == (PageNumber) INT_MAX + 4, "page count above INT_MAX");
+  big = (PageNumber) INT_MAX + 2;
+  memset(ph, 0, PAGE_SIZE);
+  strcpy(ph, "Page-big");
+  CHECK(writeBlock(big, &fh, ph));
+  memset(ph, 0, PAGE_SIZE);
+  CHECK(readBlock(big, &fh, ph));
+  ASSERT_EQUALS_STRING("Page-big", ph, "page above INT_MAX read back");
+  ASSERT_TRUE(getBlockPos(&fh) == big, "current page above INT_MAX");
+  CHECK(freePage(big, &fh));
+  CHECK(closePageFile(&fh));
+
+  CHECK(initBufferPool(bm, "testbig.bin", 3, RS_LRU, NULL));
+  CHECK(allocatePoolPage(bm, &page));
+  ASSERT_TRUE(page == big, "free chain keeps pages above INT_MAX");
+  CHECK(pinPage(bm, h, big + 1));
+  strcpy(h->data, "Page-pool");
+  CHECK(markDirty(bm, h));
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+  CHECK(openPageFile("testbig.bin", &fh));
+  CHECK(readBlock(big + 1, &fh, ph));
+  ASSERT_EQUALS_STRING("Page-pool", ph, "pool writes pages above INT_MAX");
+  CHECK(closePageFile(&fh));
+  CHECK(destroyPageFile("testbig.bin"));
+
+  for (i = 0; i < 7; i++)
+    free(pages[i]);
+  free(ph);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// cursor scans read through the readahead window
+void
+testReadahead (void)
+{
+  int i;
+  char expected[32];
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  testName = "Testing readahead of block cursor";
+
+  ASSERT_TRUE(posix_memalign((void **) &ph, SM_DIRECT_ALIGN, PAGE_SIZE) == 0, "aligned page");
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  for (i = 0; i < 80; i++)
+    {
+      memset(ph, 0, PAGE_SIZE);
+      sprintf(ph, "%s-%i", "Page", i);
+      CHECK(writeBlock(i, &fh, ph));
+    }
+  CHECK(closePageFile(&fh));
+
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  CHECK(readFirstBlock(&fh, ph));
+  for (i = 1; i < 80; i++)
+    {
+      CHECK(readNextBlock(&fh, ph));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, ph, "forward scan");
+    }
+  ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, readNextBlock(&fh, ph), "scan stops at the end");
+  for (i = 78; i >= 0; i--)
+    {
+      CHECK(readPreviousBlock(&fh, ph));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, ph, "backward scan");
+    }
+
+  // a write drops the page from the window
+  CHECK(readBlock(10, &fh, ph));
+  CHECK(readBlock(11, &fh, ph));
+  CHECK(readBlock(12, &fh, ph));
+  memset(ph, 0, PAGE_SIZE);
+  sprintf(ph, "%s", "changed");
+  CHECK(writeBlock(15, &fh, ph));
+  for (i = 13; i <= 15; i++)
+    CHECK(readBlock(i, &fh, ph));
+  ASSERT_EQUALS_STRING("changed", ph, "write seen by the scan");
+  CHECK(readCurrentBlock(&fh, ph));
+  ASSERT_EQUALS_STRING("changed", ph, "current block read again");
+
+  CHECK(setReadahead(&fh, 0));
+  CHECK(readBlock(16, &fh, ph));
+  CHECK(readNextBlock(&fh, ph));
+  ASSERT_EQUALS_STRING("Page-17", ph, "reads without readahead");
+  CHECK(closePageFile(&fh));
+
+  // direct I/O reads around the window
+  CHECK(openPageFileWithFlags("testbuffer.bin", &fh, SM_OPEN_DIRECT));
+  CHECK(readFirstBlock(&fh, ph));
+  for (i = 1; i < 20; i++)
+    CHECK(readNextBlock(&fh, ph));
+  ASSERT_EQUALS_STRING("Page-19", ph, "direct scan");
+  CHECK(closePageFile(&fh));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(ph);
+  TEST_DONE();
+}
+
+// dirty pages are flushed in sorted runs by several threads
+void
+testFlushRuns (void)
+{
+  int i, page;
+  char expected[32];
+  bool *dirty;
+  SM_FileHandle fh;
+  SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options = { .checksums = true, .flushThreads = 3 };
+  testName = "Testing sorted runs of forceFlushPool";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 200, RS_LRU, NULL, &options));
+  // pages in scrambled order with gaps, page 100 stays pinned
+  for (i = 0; i < 150; i++)
+    {
+      page = (i * 37) % 150;
+      if (page % 10 == 9)
+        continue;
+      CHECK(pinPage(bm, h, page));
+      sprintf(h->data, "%s-%i", "Page", page);
+      CHECK(markDirty(bm, h));
+      if (page != 100)
+        CHECK(unpinPage(bm, h));
+    }
+  CHECK(forceFlushPool(bm));
+  ASSERT_EQUALS_INT(134, getNumWriteIO(bm), "every unpinned dirty page written once");
+  dirty = getDirtyFlags(bm);
+  page = 0;
+  for (i = 0; i < 200; i++)
+    page += dirty[i];
+  free(dirty);
+  ASSERT_EQUALS_INT(1, page, "only the pinned page stays dirty");
+  h->pageNum = 100;
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(openPageFileWithFlags("testbuffer.bin", &fh, SM_OPEN_CHECKSUM));
+  ASSERT_EQUALS_INT(149, (int) fh.totalNumPages, "file ends at the last page written");
+  for (i = 0; i < 149; i++)
+    {
+      CHECK(readBlock(i, &fh, ph));
+      if (i % 10 == 9)
+        ASSERT_EQUALS_INT(0, ph[0], "page never dirtied is empty");
+      else
+        {
+          sprintf(expected, "%s-%i", "Page", i);
+          ASSERT_EQUALS_STRING(expected, ph, "page written by its run");
+        }
+    }
+  CHECK(closePageFile(&fh));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(ph);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// change a page of the shared pool and force it, many times
+static void *
+forcingPins (void *arg)
+{
+  BM_PageHandle h;
+  int page = (int) (long) arg;
+  int i;
+
+  for(i = 0; i < 20; i++)
+  {
+      if (pinPage(sharedPool, &h, page) != RC_OK)
+        {
+          __atomic_add_fetch(&concurrentErrors, 1, __ATOMIC_RELAXED);
+          continue;
+        }
+      sprintf(h.data, "%s-%i-%i", "Page", page, i);
+      markDirty(sharedPool, &h);
+      if (forcePage(sharedPool, &h) != RC_OK)
+        __atomic_add_fetch(&concurrentErrors, 1, __ATOMIC_RELAXED);
+      unpinPage(sharedPool, &h);
+  }
+  return NULL;
+}
+
+// forced pages are synced by the durability level of the pool
+void
+testDurability (void)
+{
+  int i;
+  char expected[32];
+  pthread_t threads[4];
+  SM_FileHandle fh;
+  SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PoolOptions options = { .concurrent = true, .durability = SM_DURABILITY_GROUP };
+  testName = "Testing durability levels";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(RC_BAD_DURABILITY, setDurability(&fh, 3), "unknown level");
+  memset(ph, 0, PAGE_SIZE);
+  sprintf(ph, "%s", "synced");
+  for (i = SM_DURABILITY_NONE; i <= SM_DURABILITY_GROUP; i++)
+    {
+      CHECK(setDurability(&fh, i));
+      CHECK(writeBlock(i, &fh, ph));
+      CHECK(syncPageFile(&fh));
+    }
+  CHECK(closePageFile(&fh));
+
+  // threads forcing pages share group commits
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 8, RS_LRU, NULL, &options));
+  sharedPool = bm;
+  concurrentErrors = 0;
+  for (i = 0; i < 4; i++)
+    pthread_create(&threads[i], NULL, forcingPins, (void *) (long) i);
+  for (i = 0; i < 4; i++)
+    pthread_join(threads[i], NULL);
+  ASSERT_EQUALS_INT(0, concurrentErrors, "every forced page synced");
+  CHECK(forceFlushPool(bm));
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  for (i = 0; i < 4; i++)
+    {
+      CHECK(readBlock(i, &fh, ph));
+      sprintf(expected, "%s-%i-%i", "Page", i, 19);
+      ASSERT_EQUALS_STRING(expected, ph, "last change forced");
+    }
+  CHECK(closePageFile(&fh));
+  options.durability = 7;
+  ASSERT_EQUALS_INT(RC_BAD_DURABILITY, initBufferPoolWithOptions(bm, "testbuffer.bin", 8, RS_LRU, NULL, &options), "pool checks the level");
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(ph);
+  free(bm);
+  TEST_DONE();
+}
+
+// sum of the latency histogram of one kind of I/O
+static long
+latencyCount (SM_IOClassStats *stats)
+{
+  long sum = 0;
+  int i;
+  for (i = 0; i < SM_LATENCY_BUCKETS; i++)
+    sum += stats->latency[i];
+  return sum;
+}
+
+// reads, writes, appends, syncs and seeks are counted per file
+void
+testIOStats (void)
+{
+  SM_FileHandle fh;
+  SM_IOStats stats;
+  SM_PageHandle pages[2];
+  SM_PageHandle ph = (SM_PageHandle) malloc(2 * PAGE_SIZE);
+  testName = "Testing I/O statistics";
+
+  pages[0] = ph;
+  pages[1] = ph + PAGE_SIZE;
+  memset(ph, 0, 2 * PAGE_SIZE);
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  CHECK(setReadahead(&fh, 0));
+  CHECK(getFileIOStats(&fh, &stats));
+  ASSERT_EQUALS_INT(0, (int) (stats.read.ops + stats.write.ops + stats.append.ops + stats.sync.ops), "new handle counts nothing");
+
+  // page 0 is in the file, 1 follows its end, 4 skips over 2 and 3
+  CHECK(writeBlock(0, &fh, ph));
+  CHECK(writeBlock(1, &fh, ph));
+  CHECK(writeBlock(4, &fh, ph));
+  CHECK(readBlock(0, &fh, ph));
+  CHECK(readBlock(1, &fh, ph));
+  CHECK(readBlock(2, &fh, ph));
+  CHECK(readBlocks(3, 2, &fh, pages));
+  CHECK(appendEmptyBlock(&fh));
+  CHECK(setDurability(&fh, SM_DURABILITY_SYNC));
+  CHECK(syncPageFile(&fh));
+
+  CHECK(getFileIOStats(&fh, &stats));
+  ASSERT_EQUALS_INT(1, (int) stats.write.ops, "writes");
+  ASSERT_EQUALS_INT(PAGE_SIZE, (int) stats.write.bytes, "bytes written");
+  ASSERT_EQUALS_INT(3, (int) stats.append.ops, "appends");
+  ASSERT_EQUALS_INT(5 * PAGE_SIZE, (int) stats.append.bytes, "bytes the file grew by");
+  ASSERT_EQUALS_INT(4, (int) stats.read.ops, "reads");
+  ASSERT_EQUALS_INT(5 * PAGE_SIZE, (int) stats.read.bytes, "bytes read");
+  ASSERT_EQUALS_INT(1, (int) stats.sync.ops, "syncs");
+  ASSERT_EQUALS_INT(2, (int) stats.seeks, "jumps to page 4 and back to 0");
+  ASSERT_EQUALS_INT((int) stats.read.ops, (int) latencyCount(&stats.read), "read latencies");
+  ASSERT_EQUALS_INT((int) stats.write.ops, (int) latencyCount(&stats.write), "write latencies");
+  ASSERT_EQUALS_INT((int) stats.append.ops, (int) latencyCount(&stats.append), "append latencies");
+  ASSERT_EQUALS_INT((int) stats.sync.ops, (int) latencyCount(&stats.sync), "sync latencies");
+  CHECK(closePageFile(&fh));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(ph);
+  TEST_DONE();
+}